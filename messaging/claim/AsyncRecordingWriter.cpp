@@ -0,0 +1,577 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef WIN32
+#pragma warning (disable: 4786)
+#endif // WIN32
+
+#include "AsyncRecordingWriter.h"
+#include "RecordingIndex.h"
+
+#include <messaging/slaim/errorlog.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#ifdef WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else // WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif // WIN32
+
+namespace claim {
+
+namespace {
+
+	typedef std::chrono::steady_clock Clock;
+
+	double SecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	//! A plain file descriptor, so that we control exactly when data is written and synced.
+	class RecordingFile {
+	public:
+		explicit RecordingFile(const std::string& filename)
+			: m_filename(filename)
+		{
+#ifdef WIN32
+			m_fd = _open(filename.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else // WIN32
+			m_fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif // WIN32
+			if (m_fd < 0) {
+				throw std::runtime_error("Unable to create " + filename + ": " + strerror(errno));
+			}
+		}
+
+		~RecordingFile() {
+			Close();
+		}
+
+		void Write(const char* data, size_t size) {
+			while (size > 0) {
+#ifdef WIN32
+				const int chunk = static_cast<int>((std::min)(size, static_cast<size_t>(1) << 30));
+				const int written = _write(m_fd, data, chunk);
+#else // WIN32
+				const ssize_t written = write(m_fd, data, size);
+#endif // WIN32
+				if (written < 0) {
+					if (errno == EINTR) {
+						continue;
+					}
+					throw std::runtime_error("Unable to write to " + m_filename + ": " + strerror(errno));
+				}
+				data += written;
+				size -= static_cast<size_t>(written);
+			}
+		}
+
+		void Sync() {
+#ifdef WIN32
+			const int result = _commit(m_fd);
+#else // WIN32
+			const int result = fsync(m_fd);
+#endif // WIN32
+			if (result != 0) {
+				throw std::runtime_error("Unable to sync " + m_filename + ": " + strerror(errno));
+			}
+		}
+
+		//! Cuts the file back to the given size, and continues writing from there.
+		void Truncate(uint64_t size) {
+#ifdef WIN32
+			const bool ok = _chsize_s(m_fd, static_cast<__int64>(size)) == 0
+				&& _lseeki64(m_fd, static_cast<__int64>(size), SEEK_SET) >= 0;
+#else // WIN32
+			const bool ok = ftruncate(m_fd, static_cast<off_t>(size)) == 0
+				&& lseek(m_fd, static_cast<off_t>(size), SEEK_SET) >= 0;
+#endif // WIN32
+			if (!ok) {
+				throw std::runtime_error("Unable to truncate " + m_filename + ": " + strerror(errno));
+			}
+		}
+
+		void Close() {
+			if (m_fd >= 0) {
+#ifdef WIN32
+				_close(m_fd);
+#else // WIN32
+				close(m_fd);
+#endif // WIN32
+				m_fd = -1;
+			}
+		}
+
+	private:
+		RecordingFile(const RecordingFile&);
+		RecordingFile& operator= (const RecordingFile&);
+
+		const std::string m_filename;
+		int m_fd;
+	};
+}
+
+class AsyncRecordingWriter::Impl {
+public:
+	Impl(const std::string& filename, size_t blockSize, size_t maxQueuedBlocks);
+	Impl(const RecordingSegmentSettings& segmentSettings, size_t blockSize, size_t maxQueuedBlocks);
+
+	void Run(); // the background thread
+
+	// these expect the mutex to be locked
+	bool HandOff();
+	bool IsCurrentBlockStale() const;
+
+	// the background thread only
+	void WriteBlock(RecordingBlockBuilder& block);
+	void Sync();
+	void OpenFile(const std::string& filename);
+	void OpenSegment(uint64_t startTimestamp);
+	bool IsTimeToRoll(const RecordingBlockBuilder& block) const;
+	void Roll();
+
+	// writes the index, and closes the file
+	void FinishFile(RecordingFile& finishedFile, const RecordingIndex& finishedIndex, uint64_t finishedFileSize);
+
+	const size_t blockSize;
+	const size_t maxQueuedBlocks;
+	const bool segmented;
+	const RecordingSegmentSettings segmentSettings;
+
+	mutable std::mutex mutex;
+	std::condition_variable condition;
+	std::unique_ptr<RecordingBlockBuilder> current;
+	Clock::time_point currentStarted;
+	std::deque<std::unique_ptr<RecordingBlockBuilder>> queue;
+	std::vector<std::unique_ptr<RecordingBlockBuilder>> spare; // recycled, to keep the allocations down
+	bool closing = false;
+	bool closed = false;
+	std::atomic<size_t> blocksPerSync;
+	std::atomic<double> maxSecondsBetweenSyncs;
+	std::atomic<int> compressionLevel;
+	Metrics metrics;
+	slaim::ErrorLog errorLog;
+
+	// owned by the background thread
+	std::unique_ptr<RecordingFile> file;
+	RecordingIndex index;
+	uint64_t fileSize = 0;
+	uint64_t segmentStartTimestamp = 0;
+	size_t blocksSinceSync = 0;
+	Clock::time_point lastSync;
+
+	std::thread thread;
+	std::thread closer; // finishes the previous segment, so that rolling does not hold up the writes
+};
+
+AsyncRecordingWriter::Impl::Impl(const std::string& filename, size_t blockSize, size_t maxQueuedBlocks)
+	: blockSize(blockSize)
+	, maxQueuedBlocks((std::max)(maxQueuedBlocks, static_cast<size_t>(1)))
+	, segmented(false)
+	, current(new RecordingBlockBuilder)
+	, blocksPerSync(0)
+	, maxSecondsBetweenSyncs(0)
+	, compressionLevel(0)
+	, lastSync(Clock::now())
+{
+	OpenFile(filename); // right away, so that the caller gets the possible error
+
+	thread = std::thread(&Impl::Run, this);
+}
+
+AsyncRecordingWriter::Impl::Impl(const RecordingSegmentSettings& segmentSettings, size_t blockSize, size_t maxQueuedBlocks)
+	: blockSize(blockSize)
+	, maxQueuedBlocks((std::max)(maxQueuedBlocks, static_cast<size_t>(1)))
+	, segmented(true)
+	, segmentSettings(segmentSettings)
+	, current(new RecordingBlockBuilder)
+	, blocksPerSync(0)
+	, maxSecondsBetweenSyncs(0)
+	, compressionLevel(0)
+	, lastSync(Clock::now())
+{
+	std::error_code error;
+	std::filesystem::create_directories(segmentSettings.directory, error);
+	if (error) {
+		throw std::runtime_error("Unable to create " + segmentSettings.directory + ": " + error.message());
+	}
+
+	// the segments are opened as the first blocks arrive, so that they can be named after the first message
+
+	thread = std::thread(&Impl::Run, this);
+}
+
+void AsyncRecordingWriter::Impl::OpenFile(const std::string& filename)
+{
+	file.reset(new RecordingFile(filename));
+
+	RecordingFormat::FileHeader fileHeader;
+	fileHeader.creationTimestamp = GetRecordingTimestampNow();
+
+	char buffer[RecordingFormat::fileHeaderSize];
+	fileHeader.Encode(buffer);
+	file->Write(buffer, sizeof(buffer));
+	fileSize = sizeof(buffer);
+	index.Clear();
+}
+
+void AsyncRecordingWriter::Impl::OpenSegment(uint64_t startTimestamp)
+{
+	std::string filename = GetRecordingSegmentFilename(segmentSettings, startTimestamp);
+	std::error_code error;
+	while (std::filesystem::exists(filename, error)) {
+		filename = GetRecordingSegmentFilename(segmentSettings, ++startTimestamp); // never overwrite
+	}
+	OpenFile(filename);
+	segmentStartTimestamp = startTimestamp;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	++metrics.segmentCount;
+}
+
+bool AsyncRecordingWriter::Impl::IsTimeToRoll(const RecordingBlockBuilder& block) const
+{
+	if (!file || index.GetEntries().empty()) {
+		return false;
+	}
+	const RecordingFormat::BlockHeader& header = block.GetHeader();
+	if (segmentSettings.maxSegmentBytes > 0 && fileSize + block.GetSize() + index.GetFooterSize() > segmentSettings.maxSegmentBytes) {
+		return true;
+	}
+	const uint64_t maxSegmentDuration = static_cast<uint64_t>(segmentSettings.maxSegmentSeconds * 1e9);
+	return maxSegmentDuration > 0 && header.firstTimestamp >= segmentStartTimestamp
+		&& header.firstTimestamp - segmentStartTimestamp >= maxSegmentDuration;
+}
+
+void AsyncRecordingWriter::Impl::Roll()
+{
+	if (closer.joinable()) {
+		closer.join(); // should have finished long ago
+	}
+
+	std::shared_ptr<RecordingFile> previousFile(file.release());
+	std::shared_ptr<RecordingIndex> previousIndex(new RecordingIndex);
+	std::swap(*previousIndex, index);
+	const uint64_t previousFileSize = fileSize;
+
+	closer = std::thread([this, previousFile, previousIndex, previousFileSize]() {
+		FinishFile(*previousFile, *previousIndex, previousFileSize);
+
+		std::string errors;
+		ApplyRecordingRetention(segmentSettings, std::string(), &errors);
+		if (!errors.empty()) {
+			std::lock_guard<std::mutex> lock(mutex);
+			errorLog.SetError(errors);
+		}
+	});
+}
+
+void AsyncRecordingWriter::Impl::FinishFile(RecordingFile& finishedFile, const RecordingIndex& finishedIndex, uint64_t finishedFileSize)
+{
+	try {
+		std::string footer;
+		finishedIndex.EncodeFooter(finishedFileSize, footer);
+		finishedFile.Write(footer.data(), footer.size());
+		finishedFile.Sync();
+		finishedFile.Close();
+	}
+	catch (std::exception& e) {
+		std::lock_guard<std::mutex> lock(mutex);
+		errorLog.SetError(e.what());
+	}
+}
+
+bool AsyncRecordingWriter::Impl::HandOff()
+{
+	if (queue.size() >= maxQueuedBlocks) {
+		return false; // the disk is not keeping up
+	}
+
+	queue.push_back(std::move(current));
+	if (spare.empty()) {
+		current.reset(new RecordingBlockBuilder);
+		current->Reserve(blockSize + blockSize / 4); // avoid copying while growing
+	}
+	else {
+		current = std::move(spare.back());
+		spare.pop_back();
+	}
+
+	metrics.queuedBlockCount = queue.size();
+	metrics.maxQueuedBlockCount = (std::max)(metrics.maxQueuedBlockCount, queue.size());
+	condition.notify_one();
+	return true;
+}
+
+bool AsyncRecordingWriter::Impl::IsCurrentBlockStale() const
+{
+	return !current->IsEmpty() && Clock::now() - currentStarted >= std::chrono::nanoseconds(RecordingFormat::maxBlockDuration);
+}
+
+void AsyncRecordingWriter::Impl::Run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true) {
+		if (queue.empty()) {
+			if (closing) {
+				if (current->IsEmpty()) {
+					break;
+				}
+				queue.push_back(std::move(current)); // the last one
+				current.reset(new RecordingBlockBuilder);
+			}
+			else {
+				condition.wait_for(lock, std::chrono::milliseconds(100));
+				if (queue.empty() && IsCurrentBlockStale()) {
+					HandOff(); // the writes have stopped, or the rate is low
+				}
+				if (queue.empty() && maxSecondsBetweenSyncs > 0 && blocksSinceSync > 0 && SecondsSince(lastSync) >= maxSecondsBetweenSyncs) {
+					lock.unlock();
+					Sync();
+					lock.lock();
+				}
+				continue;
+			}
+		}
+
+		std::unique_ptr<RecordingBlockBuilder> block = std::move(queue.front());
+		queue.pop_front();
+		metrics.queuedBlockCount = queue.size();
+
+		lock.unlock();
+		WriteBlock(*block);
+		block->Clear();
+		lock.lock();
+
+		spare.push_back(std::move(block)); // at most maxQueuedBlocks + 2 blocks ever exist
+	}
+
+	lock.unlock();
+
+	if (file) {
+		FinishFile(*file, index, fileSize);
+		file.reset();
+	}
+	if (closer.joinable()) {
+		closer.join();
+	}
+	if (segmented) {
+		std::string errors;
+		ApplyRecordingRetention(segmentSettings, std::string(), &errors);
+		if (!errors.empty()) {
+			lock.lock();
+			errorLog.SetError(errors);
+		}
+	}
+}
+
+void AsyncRecordingWriter::Impl::WriteBlock(RecordingBlockBuilder& block)
+{
+	const Clock::time_point start = Clock::now();
+	block.Finish();
+
+	const int level = compressionLevel;
+	if (level > 0) {
+		try {
+			block.Compress(level);
+		}
+		catch (std::exception& e) {
+			std::lock_guard<std::mutex> lock(mutex);
+			errorLog.SetError(e.what()); // write it uncompressed, then
+		}
+	}
+
+	const std::string& data = block.GetData();
+	try {
+		if (segmented) {
+			if (IsTimeToRoll(block)) {
+				Roll();
+			}
+			if (!file) {
+				OpenSegment(block.GetHeader().firstTimestamp);
+			}
+		}
+		else if (!file) {
+			throw std::runtime_error("The recording file is not open");
+		}
+		file->Write(data.data(), data.size());
+	}
+	catch (std::exception& e) {
+		std::lock_guard<std::mutex> lock(mutex);
+		errorLog.SetError(e.what());
+		++metrics.writeErrorCount;
+		if (file) {
+			// a partial write would leave a partial block in, and throw off the offsets of all the blocks after it
+			try {
+				file->Truncate(fileSize);
+			}
+			catch (std::exception& truncateError) {
+				errorLog.SetError(truncateError.what());
+				file.reset(); // abandon the file; a segmented recording continues in a new segment
+			}
+		}
+		return;
+	}
+
+	index.AddBlock(fileSize, block.GetHeader(), block.GetRawPayload());
+	fileSize += data.size();
+	++blocksSinceSync;
+
+	const double seconds = SecondsSince(start);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++metrics.blockCount;
+		metrics.bytesWritten += data.size();
+		metrics.rawBytes += RecordingFormat::blockHeaderSize + block.GetHeader().rawSize;
+		metrics.lastWriteSeconds = seconds;
+		metrics.maxWriteSeconds = (std::max)(metrics.maxWriteSeconds, seconds);
+		metrics.totalWriteSeconds += seconds;
+	}
+
+	if ((blocksPerSync > 0 && blocksSinceSync >= blocksPerSync)
+		|| (maxSecondsBetweenSyncs > 0 && SecondsSince(lastSync) >= maxSecondsBetweenSyncs)) {
+		Sync();
+	}
+}
+
+void AsyncRecordingWriter::Impl::Sync()
+{
+	const Clock::time_point start = Clock::now();
+	try {
+		if (file) {
+			file->Sync();
+		}
+	}
+	catch (std::exception& e) {
+		std::lock_guard<std::mutex> lock(mutex);
+		errorLog.SetError(e.what());
+	}
+	lastSync = Clock::now();
+	blocksSinceSync = 0;
+
+	const double seconds = SecondsSince(start);
+	std::lock_guard<std::mutex> lock(mutex);
+	++metrics.syncCount;
+	metrics.lastSyncSeconds = seconds;
+	metrics.maxSyncSeconds = (std::max)(metrics.maxSyncSeconds, seconds);
+}
+
+AsyncRecordingWriter::AsyncRecordingWriter(const std::string& filename, size_t blockSize, size_t maxQueuedBlocks)
+{
+	pimpl_ = new Impl(filename, blockSize, maxQueuedBlocks);
+}
+
+AsyncRecordingWriter::AsyncRecordingWriter(const RecordingSegmentSettings& segmentSettings, size_t blockSize, size_t maxQueuedBlocks)
+{
+	pimpl_ = new Impl(segmentSettings, blockSize, maxQueuedBlocks);
+}
+
+AsyncRecordingWriter::~AsyncRecordingWriter()
+{
+	Close();
+	delete pimpl_;
+}
+
+bool AsyncRecordingWriter::Write(const slaim::Message& msg)
+{
+	return Write(msg, GetRecordingTimestampNow());
+}
+
+bool AsyncRecordingWriter::Write(const slaim::Message& msg, uint64_t timestamp)
+{
+	std::lock_guard<std::mutex> lock(pimpl_->mutex);
+
+	if (pimpl_->closed) {
+		throw std::runtime_error("The recording has already been closed");
+	}
+
+	RecordingBlockBuilder* block = pimpl_->current.get();
+	if (!block->IsEmpty()) {
+		const uint64_t firstTimestamp = block->GetHeader().firstTimestamp;
+		const bool spansTooLong = timestamp >= firstTimestamp && timestamp - firstTimestamp >= RecordingFormat::maxBlockDuration;
+		if ((block->GetSize() >= pimpl_->blockSize || spansTooLong || !block->HasRoomFor(msg)) && !pimpl_->HandOff()) {
+			++pimpl_->metrics.droppedMessageCount;
+			return false;
+		}
+		block = pimpl_->current.get();
+	}
+
+	if (block->IsEmpty()) {
+		pimpl_->currentStarted = Clock::now();
+	}
+	block->Append(msg, timestamp);
+	++pimpl_->metrics.messageCount;
+
+	if (block->GetSize() >= pimpl_->blockSize) {
+		pimpl_->HandOff(); // if the queue is full, we try again on the next write
+	}
+	return true;
+}
+
+void AsyncRecordingWriter::Flush()
+{
+	std::lock_guard<std::mutex> lock(pimpl_->mutex);
+	if (!pimpl_->current->IsEmpty()) {
+		pimpl_->HandOff();
+	}
+}
+
+void AsyncRecordingWriter::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(pimpl_->mutex);
+		if (pimpl_->closed) {
+			return;
+		}
+		pimpl_->closing = true;
+		pimpl_->closed = true;
+		pimpl_->condition.notify_one();
+	}
+	pimpl_->thread.join();
+}
+
+void AsyncRecordingWriter::SetCompressionLevel(int level)
+{
+	pimpl_->compressionLevel = level;
+}
+
+void AsyncRecordingWriter::SetSyncPolicy(size_t blocksPerSync, double maxSecondsBetweenSyncs)
+{
+	pimpl_->blocksPerSync = blocksPerSync;
+	pimpl_->maxSecondsBetweenSyncs = maxSecondsBetweenSyncs;
+}
+
+AsyncRecordingWriter::Metrics AsyncRecordingWriter::GetMetrics() const
+{
+	std::lock_guard<std::mutex> lock(pimpl_->mutex);
+	return pimpl_->metrics;
+}
+
+std::string AsyncRecordingWriter::GetError()
+{
+	std::lock_guard<std::mutex> lock(pimpl_->mutex);
+	return pimpl_->errorLog.GetError();
+}
+
+}
@@ -0,0 +1,107 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef CLAIM_ASYNC_RECORDING_WRITER_H
+#define CLAIM_ASYNC_RECORDING_WRITER_H
+
+#include "MessageRecording.h"
+#include "SegmentedRecording.h"
+
+#include <string>
+
+namespace claim {
+
+//! Writes a recording file on a background thread.
+/*! Write() only appends the message to an in-memory block. Full blocks are handed over
+	to a background thread, which writes each of them with a single call, and calls fsync
+	according to the sync policy. Meanwhile, the caller keeps filling another block.
+
+	The memory use is bounded: if the disk cannot keep up and maxQueuedBlocks blocks are
+	already waiting to be written, further messages are dropped (and counted) rather than
+	blocking the caller. So it is safe to record directly from the receive loop:
+	<pre>
+	claim::AsyncRecordingWriter writer("recording.nmr");
+	while (...) {
+		if (postOffice.Receive(msg, 1.0)) {
+			writer.Write(msg);
+			...
+		}
+	}
+	</pre>
+*/
+class AsyncRecordingWriter {
+public:
+	/*! Throws std::runtime_error if the file cannot be created.
+		\param blockSize The block is handed over to the background thread once it reaches (roughly)
+		                 this size, or once it spans RecordingFormat::maxBlockDuration.
+		\param maxQueuedBlocks The number of full blocks that may wait for the disk.
+	*/
+	AsyncRecordingWriter(const std::string& filename, size_t blockSize = RecordingFormat::defaultBlockSize, size_t maxQueuedBlocks = 16);
+
+	//! Writes a series of segment files instead of a single file (see RecordingSegmentSettings).
+	/*! Rolling to a new segment, and deleting the oldest ones, happens on the background
+		threads, so it never holds up Write().
+		Throws std::runtime_error if the directory cannot be created.
+	*/
+	AsyncRecordingWriter(const RecordingSegmentSettings& segmentSettings, size_t blockSize = RecordingFormat::defaultBlockSize, size_t maxQueuedBlocks = 16);
+	~AsyncRecordingWriter(); // closes
+
+	//! Never waits for the disk. Returns false if the message had to be dropped.
+	bool Write(const slaim::Message& msg); // timestamped now
+	bool Write(const slaim::Message& msg, uint64_t timestamp);
+
+	//! Hands the current block over to the background thread, even if it is not full yet.
+	void Flush();
+
+	//! Writes everything that is still pending, plus the time index, and closes the file.
+	/*! Nothing can be written after this.
+	*/
+	void Close();
+
+	//! fsync after every blocksPerSync blocks, or when maxSecondsBetweenSyncs has elapsed since
+	//! the previous sync (whichever comes first). Zeros (the default) mean only when closing.
+	void SetSyncPolicy(size_t blocksPerSync, double maxSecondsBetweenSyncs);
+
+	//! Compresses the blocks using zlib at the given level (1-9), on the background thread.
+	//! Zero (the default) means no compression.
+	void SetCompressionLevel(int level);
+
+	struct Metrics {
+		uint64_t messageCount = 0;        // accepted by Write()
+		uint64_t droppedMessageCount = 0; // rejected by Write(), because the queue was full
+		size_t queuedBlockCount = 0;      // currently waiting to be written
+		size_t maxQueuedBlockCount = 0;   // the high-water mark
+		uint64_t blockCount = 0;          // written
+		uint64_t bytesWritten = 0;
+		uint64_t rawBytes = 0;            // before compression
+		uint64_t writeErrorCount = 0;
+		uint64_t syncCount = 0;
+		uint64_t segmentCount = 0;        // started
+		double lastWriteSeconds = 0;      // how long writing the latest block took
+		double maxWriteSeconds = 0;
+		double totalWriteSeconds = 0;
+		double lastSyncSeconds = 0;
+		double maxSyncSeconds = 0;
+	};
+
+	Metrics GetMetrics() const;
+
+	//! Returns the next error encountered by the background thread, if any (see slaim::ErrorLog).
+	std::string GetError();
+
+private:
+	// make the class non-copyable
+	AsyncRecordingWriter(const AsyncRecordingWriter&);
+	AsyncRecordingWriter& operator= (const AsyncRecordingWriter&);
+
+	class Impl;
+	Impl* pimpl_;
+};
+
+}
+
+#endif // CLAIM_ASYNC_RECORDING_WRITER_H
@@ -12,6 +12,51 @@
 
 #include "AttributeMessage.h"
 
+#include <string_view>
+
+namespace {
+
+// Parses the format written by slaim::ConvertMessageListToSingleMessage in place, 
+// instead of first copying each item to a temporary slaim::MessageList (which 
+// slaim::ConvertSingleMessageToMessageList does by re-allocating the remaining data 
+// for every item). Like the original, stops at the first malformed item; also stops
+// if the callback returns false.
+template <typename Callback>
+void ForEachListItem(std::string_view data, Callback callback)
+{
+	const size_t length = data.length();
+	size_t pos = 0;
+	while (pos < length) {
+		const size_t lengthEnd = data.find(' ', pos);
+		if (lengthEnd == std::string_view::npos) {
+			break;
+		}
+		// (not strtoul, because the data need not be null-terminated)
+		size_t contentsLength = 0;
+		for (size_t i = pos + 1; i < lengthEnd && data[i] >= '0' && data[i] <= '9' && contentsLength <= length; ++i) {
+			contentsLength = 10 * contentsLength + (data[i] - '0');
+		}
+		if (lengthEnd + 2 > length || contentsLength < 5 || contentsLength > length - lengthEnd - 2) {
+			break;
+		}
+		const size_t contentsBegin = lengthEnd + 2;
+		const size_t contentsEnd = contentsBegin + contentsLength;
+		if (data[contentsEnd - 3] != ')' || data[contentsEnd - 2] != '\n' || data[contentsEnd - 1] != ']') {
+			break;
+		}
+		const size_t typeEnd = data.find(' ', contentsBegin);
+		if (typeEnd == std::string_view::npos || typeEnd > contentsEnd - 3) {
+			break;
+		}
+		if (!callback(data.substr(contentsBegin, typeEnd - contentsBegin), data.substr(typeEnd + 1, contentsEnd - 3 - typeEnd - 1))) {
+			break;
+		}
+		pos = contentsEnd;
+	}
+}
+
+}
+
 namespace claim {
 
 AttributeMessage::AttributeMessage()
@@ -25,25 +70,23 @@ AttributeMessage::AttributeMessage(const slaim::Message& src)
 
 AttributeMessage& AttributeMessage::operator= (const slaim::Message& src)
 {
-	slaim::MessageList lst;
-	slaim::ConvertSingleMessageToMessageList(src, lst);
-
-	if (!lst.empty()) {
-		m_attributes.clear();
-	}
-
 	m_type = src.GetType();
 
-	slaim::MessageList::const_iterator iter = lst.begin(), iterEnd = lst.end();
-	for (; iter != iterEnd; ++iter) {
-		const slaim::Message& msg = *iter;
-		if (msg.m_type == "m_body") {
-			m_body = msg.m_text;
+	bool first = true;
+	ForEachListItem(src.m_text, [this, &first](std::string_view type, std::string_view text) {
+		if (first) {
+			m_attributes.clear();
+			first = false;
+		}
+		if (type == "m_body") {
+			m_body.assign(text.data(), text.length());
 		}
 		else {
-			m_attributes[msg.m_type] = msg.m_text;
+			// the items are typically sorted already, so hint that the new one goes to the end
+			m_attributes.insert_or_assign(m_attributes.end(), std::string(type), std::string(text));
 		}
-	}
+		return true;
+	});
 	return *this;
 }
 	
@@ -75,4 +118,17 @@ AttributeMessage::operator slaim::Message () const
 	return GetRawMessage();
 }
 
+bool FindAttribute(std::string_view rawText, std::string_view name, std::string_view& value)
+{
+	bool found = false;
+	ForEachListItem(rawText, [&](std::string_view type, std::string_view text) {
+		if (type == name) {
+			value = text;
+			found = true;
+		}
+		return !found;
+	});
+	return found;
+}
+
 }
@@ -10,6 +10,7 @@
 #define CLAIM_ATTRIBUTE_MESSAGE_H
 
 #include <string>
+#include <string_view>
 #include <map>
 #include <messaging/slaim/message.h>
 
@@ -41,6 +42,12 @@ public:
 	operator slaim::Message () const;
 };
 
+/*! Looks up a single attribute in the text of a raw message (as produced by 
+	AttributeMessage::ToRawMessage), without decoding the whole message. The body
+	can be looked up using the name "m_body". On success, value points into rawText.
+*/
+bool FindAttribute(std::string_view rawText, std::string_view name, std::string_view& value);
+
 }
 
 #endif // CLAIM_ATTRIBUTE_MESSAGE_H
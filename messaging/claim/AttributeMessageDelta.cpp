@@ -0,0 +1,245 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef WIN32
+#pragma warning (disable: 4786)
+#endif // WIN32
+
+#include "AttributeMessageDelta.h"
+#include <numcfc/IdGenerator.h>
+
+#include <cstdlib>
+#include <functional>
+#include <sstream>
+
+namespace {
+	const std::string deltaPrefix = "__claim_delta";
+	const std::string deltaMode = "__claim_delta";
+	const std::string deltaStream = "__claim_delta_stream";
+	const std::string deltaSequenceNumber = "__claim_delta_seq";
+	const std::string deltaBodyIncluded = "__claim_delta_body";
+	const std::string deltaRemoved = "__claim_delta_removed";
+
+	const char* keyframe = "keyframe";
+	const char* delta = "delta";
+
+	bool IsReserved(const std::string& key) {
+		return key.compare(0, deltaPrefix.length(), deltaPrefix) == 0;
+	}
+
+	std::string GenerateStreamId() {
+		// the full id is rather long to be repeated in every message, so let's just hash it
+		std::ostringstream oss;
+		oss << std::hex << std::hash<std::string>()(numcfc::IdGenerator().GenerateId());
+		return oss.str();
+	}
+}
+
+namespace claim {
+
+AttributeMessageDeltaEncoder::AttributeMessageDeltaEncoder(unsigned int keyframeInterval, double keyframeIntervalSeconds)
+	: m_streamId(GenerateStreamId())
+	, m_keyframeInterval(keyframeInterval)
+	, m_keyframeIntervalSeconds(keyframeIntervalSeconds)
+{
+}
+
+void AttributeMessageDeltaEncoder::Encode(const AttributeMessage& src, AttributeMessage& encoded)
+{
+	const auto now = std::chrono::steady_clock::now();
+
+	auto insertResult = m_snapshots.insert(std::make_pair(src.m_type, Snapshot()));
+	Snapshot& snapshot = insertResult.first->second;
+
+	const bool isKeyframe = insertResult.second
+		|| snapshot.deltasSinceKeyframe >= m_keyframeInterval
+		|| std::chrono::duration<double>(now - snapshot.keyframeTime).count() >= m_keyframeIntervalSeconds;
+
+	AttributeMessage result;
+	result.m_type = src.m_type;
+
+	if (isKeyframe) {
+		result.m_body = src.m_body;
+		result.m_attributes = src.m_attributes;
+		result.m_attributes[deltaMode] = keyframe;
+		snapshot.deltasSinceKeyframe = 0;
+		snapshot.keyframeTime = now;
+	}
+	else {
+		slaim::MessageList removed;
+
+		// both maps are sorted, so a single merge-like pass is enough
+		AttributeMessage::Attributes::const_iterator i = src.m_attributes.begin(), iEnd = src.m_attributes.end();
+		AttributeMessage::Attributes::const_iterator j = snapshot.attributes.begin(), jEnd = snapshot.attributes.end();
+		while (i != iEnd || j != jEnd) {
+			if (j == jEnd || (i != iEnd && i->first < j->first)) {
+				result.m_attributes.insert(result.m_attributes.end(), *i); // added
+				++i;
+			}
+			else if (i == iEnd || j->first < i->first) {
+				slaim::Message removedKey;
+				removedKey.m_type = j->first;
+				removed.push_back(removedKey);
+				++j;
+			}
+			else {
+				if (i->second != j->second) {
+					result.m_attributes.insert(result.m_attributes.end(), *i); // changed
+				}
+				++i;
+				++j;
+			}
+		}
+
+		if (!removed.empty()) {
+			result.m_attributes[deltaRemoved] = slaim::ConvertMessageListToSingleMessage(removed).m_text;
+		}
+
+		if (src.m_body != snapshot.body) {
+			result.m_body = src.m_body;
+			result.m_attributes[deltaBodyIncluded] = "1";
+		}
+
+		result.m_attributes[deltaMode] = delta;
+		++snapshot.deltasSinceKeyframe;
+	}
+
+	++snapshot.sequenceNumber;
+	result.m_attributes[deltaStream] = m_streamId;
+	result.m_attributes[deltaSequenceNumber] = std::to_string(snapshot.sequenceNumber);
+
+	snapshot.body = src.m_body;
+	snapshot.attributes = src.m_attributes;
+
+	encoded = std::move(result);
+}
+
+slaim::Message AttributeMessageDeltaEncoder::Encode(const AttributeMessage& src)
+{
+	AttributeMessage encoded;
+	Encode(src, encoded);
+	return encoded.GetRawMessage();
+}
+
+void AttributeMessageDeltaEncoder::Reset()
+{
+	m_snapshots.clear();
+}
+
+AttributeMessageDeltaDecoder::AttributeMessageDeltaDecoder(double maxIdleSeconds)
+	: m_maxIdleSeconds(maxIdleSeconds)
+	, m_lastEvictionTime(std::chrono::steady_clock::now())
+{
+}
+
+void AttributeMessageDeltaDecoder::EvictIdleSnapshots(std::chrono::steady_clock::time_point now)
+{
+	// a full pass only every so often, so a snapshot may stay for up to twice the idle time
+	if (std::chrono::duration<double>(now - m_lastEvictionTime).count() < m_maxIdleSeconds) {
+		return;
+	}
+	m_lastEvictionTime = now;
+
+	for (auto i = m_snapshots.begin(); i != m_snapshots.end(); ) {
+		if (std::chrono::duration<double>(now - i->second.lastUsedTime).count() >= m_maxIdleSeconds) {
+			i = m_snapshots.erase(i);
+		}
+		else {
+			++i;
+		}
+	}
+}
+
+bool AttributeMessageDeltaDecoder::IsDeltaEncoded(const AttributeMessage& amsg)
+{
+	return amsg.m_attributes.find(deltaMode) != amsg.m_attributes.end();
+}
+
+bool AttributeMessageDeltaDecoder::Decode(const slaim::Message& src, AttributeMessage& decoded)
+{
+	AttributeMessage amsg(src);
+	return Decode(amsg, decoded);
+}
+
+bool AttributeMessageDeltaDecoder::Decode(const AttributeMessage& src, AttributeMessage& decoded)
+{
+	AttributeMessage::Attributes::const_iterator mode = src.m_attributes.find(deltaMode);
+	if (mode == src.m_attributes.end()) {
+		if (&src != &decoded) {
+			decoded = src;
+		}
+		return true;
+	}
+
+	AttributeMessage::Attributes::const_iterator stream = src.m_attributes.find(deltaStream);
+	AttributeMessage::Attributes::const_iterator sequenceNumber = src.m_attributes.find(deltaSequenceNumber);
+	if (stream == src.m_attributes.end() || sequenceNumber == src.m_attributes.end()) {
+		return false;
+	}
+
+	const unsigned long long seq = strtoull(sequenceNumber->second.c_str(), NULL, 10);
+	const auto key = std::make_pair(src.m_type, stream->second);
+
+	const auto now = std::chrono::steady_clock::now();
+	EvictIdleSnapshots(now);
+
+	Snapshot* snapshot = NULL;
+
+	if (mode->second == keyframe) {
+		snapshot = &m_snapshots[key];
+		snapshot->body = src.m_body;
+		snapshot->attributes.clear();
+		for (const auto& attribute : src.m_attributes) {
+			if (!IsReserved(attribute.first)) {
+				snapshot->attributes.insert(snapshot->attributes.end(), attribute);
+			}
+		}
+	}
+	else {
+		auto i = m_snapshots.find(key);
+		if (i == m_snapshots.end()) {
+			return false; // no keyframe received yet
+		}
+		if (seq != i->second.sequenceNumber + 1) {
+			m_snapshots.erase(i); // missed something: need to wait for the next keyframe
+			return false;
+		}
+
+		snapshot = &i->second;
+
+		for (const auto& attribute : src.m_attributes) {
+			if (!IsReserved(attribute.first)) {
+				snapshot->attributes[attribute.first] = attribute.second;
+			}
+		}
+
+		AttributeMessage::Attributes::const_iterator removed = src.m_attributes.find(deltaRemoved);
+		if (removed != src.m_attributes.end()) {
+			slaim::Message removedMessage;
+			removedMessage.m_text = removed->second;
+			slaim::MessageList removedKeys;
+			slaim::ConvertSingleMessageToMessageList(removedMessage, removedKeys);
+			for (const slaim::Message& removedKey : removedKeys) {
+				snapshot->attributes.erase(removedKey.m_type);
+			}
+		}
+
+		if (src.m_attributes.find(deltaBodyIncluded) != src.m_attributes.end()) {
+			snapshot->body = src.m_body;
+		}
+	}
+
+	snapshot->sequenceNumber = seq;
+	snapshot->lastUsedTime = now;
+
+	decoded.m_type = src.m_type;
+	decoded.m_body = snapshot->body;
+	decoded.m_attributes = snapshot->attributes;
+	return true;
+}
+
+}
@@ -0,0 +1,98 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef CLAIM_ATTRIBUTE_MESSAGE_DELTA_H
+#define CLAIM_ATTRIBUTE_MESSAGE_DELTA_H
+
+#include "AttributeMessage.h"
+
+#include <string>
+#include <map>
+#include <chrono>
+
+namespace claim {
+
+//! Sender side of the (opt-in) delta mode for AttributeMessage streams.
+/*! For each message type, the encoder remembers the last snapshot that it has sent,
+	and transmits only the attributes that have changed (or been removed) since.
+	Every now and then a full keyframe is sent, so that receivers that join late
+	-- or that lose a message -- are able to catch up.
+
+	The encoded messages are ordinary AttributeMessages with a few additional
+	attributes prefixed with "__claim_delta". Use AttributeMessageDeltaDecoder on the
+	receiving side to rebuild the full messages.
+*/
+class AttributeMessageDeltaEncoder {
+public:
+	/*! \param keyframeInterval Send a full keyframe after this many deltas (per type).
+		\param keyframeIntervalSeconds Send a full keyframe at least this often (per type).
+	*/
+	AttributeMessageDeltaEncoder(unsigned int keyframeInterval = 60, double keyframeIntervalSeconds = 60.0);
+
+	void Encode(const AttributeMessage& src, AttributeMessage& encoded);
+	slaim::Message Encode(const AttributeMessage& src);
+
+	//! Makes sure that the next message of each type will be a keyframe.
+	void Reset();
+
+private:
+	struct Snapshot {
+		std::string body;
+		AttributeMessage::Attributes attributes;
+		unsigned long long sequenceNumber = 0;
+		unsigned int deltasSinceKeyframe = 0;
+		std::chrono::steady_clock::time_point keyframeTime;
+	};
+
+	const std::string m_streamId;
+	const unsigned int m_keyframeInterval;
+	const double m_keyframeIntervalSeconds;
+	std::map<std::string, Snapshot> m_snapshots;
+};
+
+//! Receiver side of the delta mode for AttributeMessage streams.
+/*! Messages that were not delta-encoded are passed through as is, so it is safe
+	to run all incoming AttributeMessages through the decoder.
+*/
+class AttributeMessageDeltaDecoder {
+public:
+	/*! \param maxIdleSeconds Forget the snapshot of a stream after no messages have been received
+		from it for this long. (Each restart of a sender starts a new stream.) A stream that
+		is idle for longer recovers from its next keyframe, like a receiver that joins late.
+	*/
+	explicit AttributeMessageDeltaDecoder(double maxIdleSeconds = 600.0);
+
+	//! Returns false if the message is a delta whose base has not been received (yet).
+	/*! In that case, the message should be ignored; the stream will recover as soon
+		as the next keyframe arrives.
+	*/
+	bool Decode(const AttributeMessage& src, AttributeMessage& decoded);
+	bool Decode(const slaim::Message& src, AttributeMessage& decoded);
+
+	//! Returns true if the message was delta-encoded (either a keyframe or a delta).
+	static bool IsDeltaEncoded(const AttributeMessage& amsg);
+
+private:
+	struct Snapshot {
+		std::string body;
+		AttributeMessage::Attributes attributes;
+		unsigned long long sequenceNumber = 0;
+		std::chrono::steady_clock::time_point lastUsedTime;
+	};
+
+	void EvictIdleSnapshots(std::chrono::steady_clock::time_point now);
+
+	// key: message type + stream id
+	std::map<std::pair<std::string, std::string>, Snapshot> m_snapshots;
+
+	const double m_maxIdleSeconds;
+	std::chrono::steady_clock::time_point m_lastEvictionTime;
+};
+
+}
+
+#endif // CLAIM_ATTRIBUTE_MESSAGE_DELTA_H
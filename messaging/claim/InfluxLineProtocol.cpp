@@ -0,0 +1,207 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef WIN32
+#pragma warning (disable: 4786)
+#endif // WIN32
+
+#include "InfluxLineProtocol.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+
+namespace {
+
+	bool IsNumber(const std::string& value) {
+		if (value.empty() || value.find_first_not_of("0123456789+-.eE") != std::string::npos) {
+			return false;
+		}
+		char* end = NULL;
+		const double d = strtod(value.c_str(), &end);
+		return end == value.c_str() + value.length() && std::isfinite(d);
+	}
+
+	bool IsInteger(const std::string& value) { // e.g., "123i"
+		if (value.length() < 2 || value.back() != 'i') {
+			return false;
+		}
+		const size_t begin = (value[0] == '-') ? 1 : 0;
+		if (begin + 1 >= value.length()) {
+			return false;
+		}
+		return value.find_first_not_of("0123456789", begin) == value.length() - 1;
+	}
+
+	bool IsBoolean(const std::string& value) {
+		static const char* booleans[] = { "t", "T", "true", "True", "TRUE", "f", "F", "false", "False", "FALSE" };
+		for (const char* boolean : booleans) {
+			if (value == boolean) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool IsReserved(const std::string& key) {
+		return key.length() >= 2 && key[0] == '_' && key[1] == '_';
+	}
+}
+
+namespace claim {
+
+const char* InfluxLineProtocolWriter::defaultTimestampAttribute = "__claim_time_ns";
+
+InfluxLineProtocolWriter::InfluxLineProtocolWriter(size_t initialCapacity)
+	: m_keepAllPoints(false)
+	, m_timestampAttribute(defaultTimestampAttribute)
+	, m_pointCount(0)
+{
+	m_body.reserve(initialCapacity);
+}
+
+void InfluxLineProtocolWriter::SetKeepAllPoints(bool keepAllPoints)
+{
+	if (keepAllPoints != m_keepAllPoints) {
+		GetBody(); // flush the last values, if any, to the body
+		m_keepAllPoints = keepAllPoints;
+	}
+}
+
+void InfluxLineProtocolWriter::SetTimestampAttribute(const std::string& timestampAttribute)
+{
+	m_timestampAttribute = timestampAttribute;
+}
+
+long long InfluxLineProtocolWriter::GetCurrentTimeNanoseconds()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void InfluxLineProtocolWriter::Add(const AttributeMessage& amsg)
+{
+	long long timestampNanoseconds = 0;
+
+	AttributeMessage::Attributes::const_iterator i = amsg.m_attributes.find(m_timestampAttribute);
+	if (i != amsg.m_attributes.end()) {
+		timestampNanoseconds = strtoll(i->second.c_str(), NULL, 10);
+	}
+	if (timestampNanoseconds <= 0) {
+		timestampNanoseconds = GetCurrentTimeNanoseconds();
+	}
+
+	Add(amsg, timestampNanoseconds);
+}
+
+void InfluxLineProtocolWriter::Add(const AttributeMessage& amsg, long long timestampNanoseconds)
+{
+	for (const auto& attribute : amsg.m_attributes) {
+		if (IsReserved(attribute.first) || attribute.first.empty()) {
+			continue;
+		}
+		if (m_keepAllPoints) {
+			AppendPoint(attribute.first, attribute.second, timestampNanoseconds);
+		}
+		else {
+			LastValue& lastValue = m_lastValues[attribute.first];
+			lastValue.value = attribute.second;
+			lastValue.timestampNanoseconds = timestampNanoseconds;
+		}
+	}
+}
+
+void InfluxLineProtocolWriter::AppendPoint(const std::string& key, const std::string& value, long long timestampNanoseconds)
+{
+	AppendEscapedSeriesKey(m_body, key);
+	m_body.append(" value=", 7);
+	AppendFieldValue(m_body, value);
+	m_body.push_back(' ');
+
+	char buffer[32];
+	const int length = snprintf(buffer, sizeof(buffer), "%lld", timestampNanoseconds);
+	m_body.append(buffer, length);
+	m_body.push_back('\n');
+
+	++m_pointCount;
+}
+
+size_t InfluxLineProtocolWriter::GetPointCount() const
+{
+	return m_pointCount + m_lastValues.size();
+}
+
+bool InfluxLineProtocolWriter::IsEmpty() const
+{
+	return GetPointCount() == 0;
+}
+
+const std::string& InfluxLineProtocolWriter::GetBody()
+{
+	for (const auto& lastValue : m_lastValues) {
+		AppendPoint(lastValue.first, lastValue.second.value, lastValue.second.timestampNanoseconds);
+	}
+	m_lastValues.clear();
+	return m_body;
+}
+
+void InfluxLineProtocolWriter::Clear()
+{
+	m_body.clear();
+	m_lastValues.clear();
+	m_pointCount = 0;
+}
+
+void InfluxLineProtocolWriter::AppendEscapedSeriesKey(std::string& output, const std::string& key)
+{
+	// The key already contains the comma and equals sign separators of the tags (if any),
+	// so only spaces (that have not been escaped yet) and line breaks need to be taken care of.
+	const size_t length = key.length();
+	size_t begin = 0;
+	for (size_t i = 0; i < length; ++i) {
+		const char c = key[i];
+		if (c == ' ' || c == '\n' || c == '\r') {
+			output.append(key, begin, i - begin);
+			if (c == ' ') {
+				if (i == 0 || key[i - 1] != '\\') {
+					output.push_back('\\');
+				}
+				output.push_back(' ');
+			}
+			else {
+				output.append(c == '\n' ? "\\n" : "\\r");
+			}
+			begin = i + 1;
+		}
+	}
+	output.append(key, begin, length - begin);
+}
+
+void InfluxLineProtocolWriter::AppendFieldValue(std::string& output, const std::string& value)
+{
+	if (IsNumber(value) || IsInteger(value) || IsBoolean(value)) {
+		output.append(value);
+		return;
+	}
+
+	output.push_back('"');
+	const size_t length = value.length();
+	size_t begin = 0;
+	for (size_t i = 0; i < length; ++i) {
+		const char c = value[i];
+		if (c == '"' || c == '\\' || c == '\n') {
+			output.append(value, begin, i - begin);
+			output.push_back('\\');
+			output.push_back(c == '\n' ? 'n' : c);
+			begin = i + 1;
+		}
+	}
+	output.append(value, begin, length - begin);
+	output.push_back('"');
+}
+
+}
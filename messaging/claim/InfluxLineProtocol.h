@@ -0,0 +1,77 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef CLAIM_INFLUX_LINE_PROTOCOL_H
+#define CLAIM_INFLUX_LINE_PROTOCOL_H
+
+#include "AttributeMessage.h"
+
+#include <string>
+#include <unordered_map>
+
+namespace claim {
+
+//! Serializes AttributeMessages into the InfluxDB line protocol.
+/*! Each attribute becomes one point: the attribute name is used as the series key
+	(measurement plus optional tags, e.g. "freeBytes_GB,hostname=foo"), and the
+	attribute value is written as the field "value". Attributes whose name begins with
+	"__" are reserved for internal use, and are not written.
+
+	The timestamp of the points is read from the attribute named by
+	SetTimestampAttribute() (nanoseconds since 1970-01-01 UTC), if the message has one;
+	otherwise the time of the Add() call is used.
+
+	All points are written to a single buffer, which is reused across Clear() calls.
+*/
+class InfluxLineProtocolWriter {
+public:
+	static const char* defaultTimestampAttribute; // "__claim_time_ns"
+
+	explicit InfluxLineProtocolWriter(size_t initialCapacity = 1024 * 1024);
+
+	//! If set, every point is written; otherwise, only the last value of each series is (the default).
+	void SetKeepAllPoints(bool keepAllPoints);
+	void SetTimestampAttribute(const std::string& timestampAttribute);
+
+	void Add(const AttributeMessage& amsg);
+	void Add(const AttributeMessage& amsg, long long timestampNanoseconds);
+
+	size_t GetPointCount() const;
+	bool IsEmpty() const;
+
+	//! Returns the line protocol, ready to be POSTed to the /write endpoint.
+	const std::string& GetBody();
+
+	//! Removes all points, but retains the allocated buffer.
+	void Clear();
+
+	//! Appends a series key, escaping the characters that the line protocol requires to be escaped.
+	static void AppendEscapedSeriesKey(std::string& output, const std::string& key);
+	//! Appends a field value: numbers and booleans are written as is; anything else as a quoted string.
+	static void AppendFieldValue(std::string& output, const std::string& value);
+
+	static long long GetCurrentTimeNanoseconds();
+
+private:
+	void AppendPoint(const std::string& key, const std::string& value, long long timestampNanoseconds);
+
+	bool m_keepAllPoints;
+	std::string m_timestampAttribute;
+
+	std::string m_body;
+	size_t m_pointCount;
+
+	struct LastValue {
+		std::string value;
+		long long timestampNanoseconds;
+	};
+	std::unordered_map<std::string, LastValue> m_lastValues; // used only if !m_keepAllPoints
+};
+
+}
+
+#endif // CLAIM_INFLUX_LINE_PROTOCOL_H
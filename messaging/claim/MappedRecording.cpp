@@ -0,0 +1,328 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef WIN32
+#pragma warning (disable: 4786)
+#endif // WIN32
+
+#include "MappedRecording.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+
+#ifdef WIN32
+#include <windows.h>
+#else // WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // WIN32
+
+namespace claim {
+
+void RecordedMessageView::ToMessage(slaim::Message& msg) const
+{
+	msg.m_type.assign(type.data(), type.length());
+	msg.m_text.assign(text.data(), text.length());
+}
+
+slaim::Message RecordedMessageView::ToMessage() const
+{
+	slaim::Message msg;
+	ToMessage(msg);
+	return msg;
+}
+
+class MappedRecordingReader::Mapping {
+public:
+	Mapping(const std::string& filename);
+	~Mapping();
+
+	const char* data = NULL;
+	size_t size = 0;
+
+private:
+#ifdef WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#endif // WIN32
+};
+
+#ifdef WIN32
+
+MappedRecordingReader::Mapping::Mapping(const std::string& filename)
+{
+	file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Unable to open " + filename);
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		throw std::runtime_error("Unable to get the size of " + filename);
+	}
+	size = static_cast<size_t>(fileSize.QuadPart);
+	if (size > 0) {
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL) {
+			data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+		if (data == NULL) {
+			if (mapping != NULL) {
+				CloseHandle(mapping);
+			}
+			CloseHandle(file);
+			throw std::runtime_error("Unable to map " + filename);
+		}
+	}
+}
+
+MappedRecordingReader::Mapping::~Mapping()
+{
+	if (data) {
+		UnmapViewOfFile(data);
+	}
+	if (mapping != NULL) {
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+}
+
+#else // WIN32
+
+MappedRecordingReader::Mapping::Mapping(const std::string& filename)
+{
+	const int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("Unable to open " + filename + ": " + strerror(errno));
+	}
+	struct stat s;
+	if (fstat(fd, &s) != 0) {
+		close(fd);
+		throw std::runtime_error("Unable to get the size of " + filename + ": " + strerror(errno));
+	}
+	size = static_cast<size_t>(s.st_size);
+	if (size > 0) {
+		void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED) {
+			const std::string error = strerror(errno);
+			close(fd);
+			throw std::runtime_error("Unable to map " + filename + ": " + error);
+		}
+		madvise(p, size, MADV_SEQUENTIAL);
+		data = static_cast<const char*>(p);
+	}
+	close(fd); // the mapping remains valid
+}
+
+MappedRecordingReader::Mapping::~Mapping()
+{
+	if (data) {
+		munmap(const_cast<char*>(data), size);
+	}
+}
+
+#endif // WIN32
+
+MappedRecordingReader::MappedRecordingReader(const std::string& filename)
+	: m_data(NULL)
+	, m_size(0)
+	, m_legacy(false)
+	, m_next(NULL)
+	, m_blockPosition(NULL)
+	, m_blockEnd(NULL)
+	, m_indexLoaded(false)
+	, m_mapping(new Mapping(filename))
+{
+	m_data = m_mapping->data;
+	m_size = m_mapping->size;
+
+	if (m_size >= RecordingFormat::fileHeaderSize && m_fileHeader.Decode(m_data)) {
+		if (m_fileHeader.version > RecordingFormat::currentVersion) {
+			delete m_mapping;
+			throw std::runtime_error("Unsupported recording format version in " + filename);
+		}
+	}
+	else {
+		m_legacy = true;
+	}
+
+	Rewind();
+}
+
+MappedRecordingReader::~MappedRecordingReader()
+{
+	delete m_mapping;
+}
+
+void MappedRecordingReader::Rewind()
+{
+	m_next = m_legacy ? m_data : m_data + RecordingFormat::fileHeaderSize;
+	m_blockPosition = m_blockEnd = NULL;
+}
+
+const RecordingIndex& MappedRecordingReader::GetIndex()
+{
+	if (!m_indexLoaded) {
+		if (!m_legacy && !m_index.Load(m_data, m_size)) {
+			m_index.Build(m_data, m_size); // index what we can
+		}
+		m_indexLoaded = true;
+	}
+	return m_index;
+}
+
+bool MappedRecordingReader::SeekToTime(uint64_t timestamp)
+{
+	if (m_legacy) {
+		return false; // no timestamps
+	}
+
+	const RecordingIndex& index = GetIndex();
+	const std::vector<RecordingIndex::Entry>& entries = index.GetEntries();
+	const size_t i = index.FindBlock(timestamp);
+	if (i == entries.size()) {
+		m_next = NULL;
+		m_blockPosition = m_blockEnd = NULL;
+		return false;
+	}
+
+	m_next = m_data + entries[i].offset;
+	m_blockPosition = m_blockEnd = NULL;
+
+	while (true) {
+		while (m_blockPosition == m_blockEnd) {
+			if (!NextBlock()) {
+				return false;
+			}
+		}
+		const char* p = m_blockPosition;
+		uint64_t recordTimestamp = 0;
+		const char* type = NULL;
+		const char* text = NULL;
+		size_t typeLength = 0, textLength = 0;
+		if (!RecordingFormat::DecodeRecord(p, m_blockEnd, recordTimestamp, type, typeLength, text, textLength)) {
+			m_blockPosition = m_blockEnd = NULL;
+			m_next = NULL;
+			return false; // corrupt block
+		}
+		if (recordTimestamp >= timestamp) {
+			return true;
+		}
+		m_blockPosition = p;
+	}
+}
+
+bool MappedRecordingReader::NextBlock()
+{
+	const char* end = m_data + m_size;
+
+	while (m_next && static_cast<size_t>(end - m_next) >= RecordingFormat::blockHeaderSize) {
+		RecordingFormat::BlockHeader header;
+		if (!header.Decode(m_next)) {
+			break; // corrupt
+		}
+		const char* payload = m_next + RecordingFormat::blockHeaderSize;
+		if (header.storedSize > static_cast<uint64_t>(end - payload)) {
+			break; // truncated
+		}
+		m_next = payload + header.storedSize;
+
+		if (header.blockType != RecordingFormat::MessageBlock) {
+			continue; // not for us
+		}
+		if (header.compression != RecordingFormat::NoCompression) {
+			try {
+				RecordingFormat::DecompressPayload(header, payload, m_decompressed);
+			}
+			catch (std::exception&) {
+				break; // corrupt, or too big to be decompressed here
+			}
+			m_blockPosition = m_decompressed.data();
+			m_blockEnd = m_blockPosition + m_decompressed.size();
+			return true;
+		}
+
+		m_blockPosition = payload;
+		m_blockEnd = m_next;
+		return true;
+	}
+
+	m_next = NULL;
+	return false;
+}
+
+bool MappedRecordingReader::Next(RecordedMessageView& view)
+{
+	if (m_legacy) {
+		return NextLegacy(view);
+	}
+
+	while (m_blockPosition == m_blockEnd) {
+		if (!NextBlock()) {
+			return false;
+		}
+	}
+
+	const char* type = NULL;
+	const char* text = NULL;
+	size_t typeLength = 0, textLength = 0;
+	if (!RecordingFormat::DecodeRecord(m_blockPosition, m_blockEnd, view.timestamp, type, typeLength, text, textLength)) {
+		m_blockPosition = m_blockEnd = NULL;
+		m_next = NULL;
+		return false; // corrupt block
+	}
+
+	view.type = std::string_view(type, typeLength);
+	view.text = std::string_view(text, textLength);
+	return true;
+}
+
+bool MappedRecordingReader::NextLegacy(RecordedMessageView& view)
+{
+	// see WriteMessageToStream
+	const char* end = m_data + m_size;
+	const char* p = m_next;
+	std::string_view* outputs[2] = { &view.type, &view.text };
+
+	for (int i = 0; i < 2; ++i) {
+		int length = -1;
+		if (!p || end - p < static_cast<std::ptrdiff_t>(sizeof(length))) {
+			m_next = NULL;
+			return false;
+		}
+		memcpy(&length, p, sizeof(length));
+		p += sizeof(length);
+		if (length < 0 || (i == 0 && length == 0) || end - p < length) {
+			m_next = NULL;
+			return false;
+		}
+		*outputs[i] = std::string_view(p, length);
+		p += length;
+	}
+
+	view.timestamp = 0;
+	m_next = p;
+	return true;
+}
+
+bool MappedRecordingReader::Read(slaim::Message& msg, uint64_t* timestamp)
+{
+	RecordedMessageView view;
+	if (!Next(view)) {
+		return false;
+	}
+	view.ToMessage(msg);
+	if (timestamp) {
+		*timestamp = view.timestamp;
+	}
+	return true;
+}
+
+}
@@ -0,0 +1,96 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef CLAIM_MAPPED_RECORDING_H
+#define CLAIM_MAPPED_RECORDING_H
+
+#include "RecordingIndex.h"
+
+#include <string>
+#include <string_view>
+
+namespace claim {
+
+//! A recorded message that points directly to the memory of a MappedRecordingReader.
+/*! The views are valid as long as the reader is; except that messages in compressed blocks
+	are decompressed into a buffer that is reused for the next block.
+*/
+struct RecordedMessageView {
+	uint64_t timestamp = 0;
+	std::string_view type;
+	std::string_view text;
+
+	//! Copies the message, reusing the capacity of msg.
+	void ToMessage(slaim::Message& msg) const;
+	slaim::Message ToMessage() const;
+};
+
+//! Reads a recording file by mapping it to memory, without copying the messages.
+/*! Both the recording format and the legacy WriteMessageToStream format are supported.
+	The file is mapped as a whole, and the OS is advised that it is going to be read
+	sequentially; so scanning even large recordings is limited by the I/O bandwidth
+	rather than by allocations.
+*/
+class MappedRecordingReader {
+public:
+	//! Throws std::runtime_error if the file cannot be opened or mapped.
+	explicit MappedRecordingReader(const std::string& filename);
+	~MappedRecordingReader();
+
+	//! Returns false at the end of the file, or if the rest of the data is truncated or corrupt.
+	bool Next(RecordedMessageView& view);
+
+	//! Like Next(), but hands out an owned copy.
+	bool Read(slaim::Message& msg, uint64_t* timestamp = NULL);
+
+	//! Starts reading from the beginning again.
+	void Rewind();
+
+	//! Positions the reader at the first message whose timestamp is at or after the given one.
+	/*! Binary-searches the time index. Returns false if there is no such message.
+	*/
+	bool SeekToTime(uint64_t timestamp);
+
+	//! Returns the time index stored in the recording, or rebuilds it if the recording was not closed properly.
+	const RecordingIndex& GetIndex();
+
+	bool IsLegacyFormat() const { return m_legacy; }
+	const RecordingFormat::FileHeader& GetFileHeader() const { return m_fileHeader; }
+
+	const char* GetData() const { return m_data; }
+	size_t GetSize() const { return m_size; }
+
+private:
+	// make the class non-copyable
+	MappedRecordingReader(const MappedRecordingReader&);
+	MappedRecordingReader& operator= (const MappedRecordingReader&);
+
+	bool NextBlock();
+	bool NextLegacy(RecordedMessageView& view);
+
+	const char* m_data;
+	size_t m_size;
+
+	bool m_legacy;
+	RecordingFormat::FileHeader m_fileHeader;
+
+	const char* m_next;        // the next block (or, for the legacy format, the next message)
+	const char* m_blockPosition;
+	const char* m_blockEnd;
+
+	RecordingIndex m_index;
+	bool m_indexLoaded;
+
+	std::string m_decompressed; // the current block, if compressed
+
+	class Mapping;
+	Mapping* m_mapping;
+};
+
+}
+
+#endif // CLAIM_MAPPED_RECORDING_H
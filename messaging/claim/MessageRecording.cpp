@@ -0,0 +1,532 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef WIN32
+#pragma warning (disable: 4786)
+#endif // WIN32
+
+#include "MessageRecording.h"
+#include "RecordingIndex.h"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <new>
+#include <algorithm>
+
+#ifdef CLAIM_HAVE_ZLIB
+#include <zlib.h>
+#endif // CLAIM_HAVE_ZLIB
+
+namespace claim {
+
+namespace RecordingFormat {
+
+void PutUInt32(char* p, uint32_t value)
+{
+	for (int i = 0; i < 4; ++i) {
+		p[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+	}
+}
+
+void PutUInt64(char* p, uint64_t value)
+{
+	for (int i = 0; i < 8; ++i) {
+		p[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+	}
+}
+
+uint32_t GetUInt32(const char* p)
+{
+	uint32_t value = 0;
+	for (int i = 3; i >= 0; --i) {
+		value = (value << 8) | static_cast<unsigned char>(p[i]);
+	}
+	return value;
+}
+
+uint64_t GetUInt64(const char* p)
+{
+	uint64_t value = 0;
+	for (int i = 7; i >= 0; --i) {
+		value = (value << 8) | static_cast<unsigned char>(p[i]);
+	}
+	return value;
+}
+
+const char fileMagic[8] = { '\x89', 'N', 'M', 'R', '\r', '\n', '\x1a', '\n' };
+
+void FileHeader::Encode(char* output) const
+{
+	memcpy(output, fileMagic, sizeof(fileMagic));
+	PutUInt32(output + 8, version);
+	PutUInt32(output + 12, flags);
+	PutUInt64(output + 16, creationTimestamp);
+	PutUInt64(output + 24, 0); // reserved
+}
+
+bool FileHeader::Decode(const char* input)
+{
+	if (memcmp(input, fileMagic, sizeof(fileMagic)) != 0) {
+		return false;
+	}
+	version = GetUInt32(input + 8);
+	flags = GetUInt32(input + 12);
+	creationTimestamp = GetUInt64(input + 16);
+	return true;
+}
+
+void BlockHeader::Encode(char* output) const
+{
+	PutUInt32(output, blockMagic);
+	PutUInt32(output + 4, blockType);
+	PutUInt32(output + 8, compression);
+	PutUInt32(output + 12, messageCount);
+	PutUInt64(output + 16, storedSize);
+	PutUInt64(output + 24, rawSize);
+	PutUInt64(output + 32, firstTimestamp);
+	PutUInt64(output + 40, lastTimestamp);
+}
+
+bool BlockHeader::Decode(const char* input)
+{
+	if (GetUInt32(input) != blockMagic) {
+		return false;
+	}
+	blockType = GetUInt32(input + 4);
+	compression = GetUInt32(input + 8);
+	messageCount = GetUInt32(input + 12);
+	storedSize = GetUInt64(input + 16);
+	rawSize = GetUInt64(input + 24);
+	firstTimestamp = GetUInt64(input + 32);
+	lastTimestamp = GetUInt64(input + 40);
+	const uint64_t maxSize = messageCount == 1 && blockType == MessageBlock ? maxSingleMessageBlockSize : maxBlockSize;
+	return storedSize <= maxSize && rawSize <= maxSize; // rather than trying to allocate whatever
+}
+
+bool DecodeRecord(const char*& p, const char* end, uint64_t& timestamp, const char*& type, size_t& typeLength, const char*& text, size_t& textLength)
+{
+	if (static_cast<size_t>(end - p) < recordHeaderSize) {
+		return false;
+	}
+	timestamp = GetUInt64(p);
+	const uint64_t typeLength64 = GetUInt32(p + 8);
+	const uint64_t textLength64 = GetUInt64(p + 12);
+	const uint64_t available = static_cast<uint64_t>(end - p) - recordHeaderSize;
+	if (typeLength64 > available || textLength64 > available - typeLength64) {
+		return false;
+	}
+	type = p + recordHeaderSize;
+	typeLength = static_cast<size_t>(typeLength64);
+	text = type + typeLength;
+	textLength = static_cast<size_t>(textLength64);
+	p = text + textLength;
+	return true;
+}
+
+bool IsCompressionSupported(uint32_t compression)
+{
+	switch (compression) {
+	case NoCompression:
+		return true;
+#ifdef CLAIM_HAVE_ZLIB
+	case ZlibCompression:
+		return true;
+#endif // CLAIM_HAVE_ZLIB
+	default:
+		return false;
+	}
+}
+
+void DecompressPayload(const BlockHeader& header, const char* stored, std::string& raw)
+{
+	if (header.compression == NoCompression) {
+		raw.assign(stored, static_cast<size_t>(header.storedSize));
+		return;
+	}
+#ifdef CLAIM_HAVE_ZLIB
+	if (header.compression == ZlibCompression) {
+		raw.resize(static_cast<size_t>(header.rawSize));
+		uLongf rawSize = static_cast<uLongf>(header.rawSize);
+		if (raw.empty() || uncompress(reinterpret_cast<Bytef*>(&raw[0]), &rawSize, reinterpret_cast<const Bytef*>(stored), static_cast<uLong>(header.storedSize)) != Z_OK
+			|| rawSize != header.rawSize) {
+			throw std::runtime_error("Corrupt compressed recording block");
+		}
+		return;
+	}
+#endif // CLAIM_HAVE_ZLIB
+	throw std::runtime_error("Unsupported recording block compression");
+}
+
+bool IsRecording(const char* firstBytes, size_t length)
+{
+	return length >= sizeof(fileMagic) && memcmp(firstBytes, fileMagic, sizeof(fileMagic)) == 0;
+}
+
+}
+
+uint64_t GetRecordingTimestampNow()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+RecordingBlockBuilder::RecordingBlockBuilder()
+	: m_compressed(false)
+{
+	Clear();
+}
+
+void RecordingBlockBuilder::Append(const slaim::Message& msg, uint64_t timestamp)
+{
+	if (!HasRoomFor(msg)) {
+		throw std::runtime_error("The message does not fit in the recording block");
+	}
+
+	const size_t typeLength = msg.m_type.length();
+	const size_t textLength = msg.m_text.length();
+
+	const size_t position = m_data.size();
+	m_data.resize(position + RecordingFormat::recordHeaderSize + typeLength + textLength);
+
+	char* p = &m_data[position];
+	RecordingFormat::PutUInt64(p, timestamp);
+	RecordingFormat::PutUInt32(p + 8, static_cast<uint32_t>(typeLength));
+	RecordingFormat::PutUInt64(p + 12, textLength);
+	p += RecordingFormat::recordHeaderSize;
+	memcpy(p, msg.m_type.data(), typeLength);
+	p += typeLength;
+	memcpy(p, msg.m_text.data(), textLength);
+
+	if (m_header.messageCount == 0) {
+		m_header.firstTimestamp = timestamp;
+	}
+	m_header.lastTimestamp = timestamp;
+	++m_header.messageCount;
+}
+
+bool RecordingBlockBuilder::HasRoomFor(const slaim::Message& msg) const
+{
+	const uint64_t recordSize = RecordingFormat::recordHeaderSize + msg.m_type.length() + msg.m_text.length();
+	const uint64_t maxSize = IsEmpty() ? RecordingFormat::maxSingleMessageBlockSize : RecordingFormat::maxBlockSize;
+	const uint64_t payloadSize = m_data.size() - RecordingFormat::blockHeaderSize;
+	return payloadSize <= maxSize && recordSize <= maxSize - payloadSize;
+}
+
+void RecordingBlockBuilder::Finish()
+{
+	m_header.storedSize = m_data.size() - RecordingFormat::blockHeaderSize;
+	m_header.rawSize = m_header.storedSize;
+	m_header.Encode(&m_data[0]);
+}
+
+void RecordingBlockBuilder::Compress(int level)
+{
+#ifdef CLAIM_HAVE_ZLIB
+	const size_t rawSize = m_data.size() - RecordingFormat::blockHeaderSize;
+	uLongf compressedSize = compressBound(static_cast<uLong>(rawSize));
+	m_compressedData.resize(RecordingFormat::blockHeaderSize + compressedSize);
+	const int result = compress2(reinterpret_cast<Bytef*>(&m_compressedData[RecordingFormat::blockHeaderSize]), &compressedSize,
+		reinterpret_cast<const Bytef*>(GetRawPayload()), static_cast<uLong>(rawSize), level);
+	if (result != Z_OK || compressedSize >= rawSize) {
+		return; // keep it uncompressed
+	}
+	m_compressedData.resize(RecordingFormat::blockHeaderSize + compressedSize);
+	m_header.compression = RecordingFormat::ZlibCompression;
+	m_header.storedSize = compressedSize;
+	m_header.Encode(&m_compressedData[0]);
+	m_compressed = true;
+#else // CLAIM_HAVE_ZLIB
+	(void)level;
+	throw std::runtime_error("Recording compression is not available (built without zlib)");
+#endif // CLAIM_HAVE_ZLIB
+}
+
+void RecordingBlockBuilder::Clear()
+{
+	m_compressed = false;
+	m_header = RecordingFormat::BlockHeader();
+	m_data.resize(RecordingFormat::blockHeaderSize); // reserve room for the header, to be filled in by Finish()
+}
+
+void RecordingBlockBuilder::Swap(RecordingBlockBuilder& that)
+{
+	std::swap(m_header, that.m_header);
+	m_data.swap(that.m_data);
+	m_compressedData.swap(that.m_compressedData);
+	std::swap(m_compressed, that.m_compressed);
+}
+
+MessageRecordingWriter::MessageRecordingWriter(std::ostream& output, size_t blockSize)
+	: m_output(output)
+	, m_blockSize(blockSize)
+	, m_index(new RecordingIndex)
+	, m_messageCount(0)
+	, m_bytesWritten(0)
+	, m_closed(false)
+	, m_compressionLevel(0)
+{
+	RecordingFormat::FileHeader fileHeader;
+	fileHeader.creationTimestamp = GetRecordingTimestampNow();
+
+	char buffer[RecordingFormat::fileHeaderSize];
+	fileHeader.Encode(buffer);
+	m_output.write(buffer, sizeof(buffer));
+	m_bytesWritten += sizeof(buffer);
+}
+
+MessageRecordingWriter::~MessageRecordingWriter()
+{
+	try {
+		Close();
+	}
+	catch (...) {
+		// destructors should not throw
+	}
+	delete m_index;
+}
+
+void MessageRecordingWriter::Write(const slaim::Message& msg)
+{
+	Write(msg, GetRecordingTimestampNow());
+}
+
+void MessageRecordingWriter::Write(const slaim::Message& msg, uint64_t timestamp)
+{
+	if (m_closed) {
+		throw std::runtime_error("The recording has already been closed");
+	}
+
+	if (!m_block.IsEmpty()) {
+		const uint64_t firstTimestamp = m_block.GetHeader().firstTimestamp;
+		if (timestamp >= firstTimestamp && timestamp - firstTimestamp >= RecordingFormat::maxBlockDuration) {
+			Flush(); // keep the index fine-grained even when the rate is low
+		}
+		else if (!m_block.HasRoomFor(msg)) {
+			Flush(); // a huge message gets a block of its own
+		}
+	}
+
+	m_block.Append(msg, timestamp);
+	m_index->AddMessage(msg.m_type);
+	++m_messageCount;
+
+	if (m_block.GetSize() >= m_blockSize) {
+		Flush();
+	}
+}
+
+void MessageRecordingWriter::Flush()
+{
+	if (m_block.IsEmpty()) {
+		return;
+	}
+	m_block.Finish();
+	if (m_compressionLevel > 0) {
+		m_block.Compress(m_compressionLevel);
+	}
+	m_index->FinishBlock(m_bytesWritten, m_block.GetHeader());
+	const std::string& data = m_block.GetData();
+	m_output.write(data.data(), static_cast<std::streamsize>(data.size()));
+	m_bytesWritten += data.size();
+	m_block.Clear();
+	m_output.flush();
+}
+
+void MessageRecordingWriter::Close()
+{
+	if (m_closed) {
+		return;
+	}
+	Flush();
+	m_closed = true;
+
+	std::string footer;
+	m_index->EncodeFooter(m_bytesWritten, footer);
+	m_output.write(footer.data(), static_cast<std::streamsize>(footer.size()));
+	m_bytesWritten += footer.size();
+	m_output.flush();
+}
+
+MessageRecordingReader::MessageRecordingReader(std::istream& input)
+	: m_input(input)
+	, m_pendingPosition(0)
+	, m_legacy(false)
+	, m_position(NULL)
+	, m_end(NULL)
+{
+	m_pending.resize(RecordingFormat::fileHeaderSize);
+	m_input.read(&m_pending[0], static_cast<std::streamsize>(m_pending.size()));
+	m_pending.resize(static_cast<size_t>(m_input.gcount()));
+
+	if (m_pending.size() == RecordingFormat::fileHeaderSize && m_fileHeader.Decode(m_pending.data())) {
+		if (m_fileHeader.version > RecordingFormat::currentVersion) {
+			throw std::runtime_error("Unsupported recording format version");
+		}
+		m_pending.clear();
+	}
+	else {
+		m_legacy = true; // the bytes read so far are part of the first message
+	}
+}
+
+bool MessageRecordingReader::ReadBytes(char* output, size_t length)
+{
+	if (m_pendingPosition < m_pending.size()) {
+		const size_t n = (std::min)(length, m_pending.size() - m_pendingPosition);
+		memcpy(output, &m_pending[m_pendingPosition], n);
+		m_pendingPosition += n;
+		output += n;
+		length -= n;
+	}
+	if (length > 0) {
+		m_input.read(output, static_cast<std::streamsize>(length));
+		return static_cast<size_t>(m_input.gcount()) == length;
+	}
+	return true;
+}
+
+bool MessageRecordingReader::ReadBlock()
+{
+	while (true) {
+		char buffer[RecordingFormat::blockHeaderSize];
+		if (!ReadBytes(buffer, sizeof(buffer))) {
+			return false;
+		}
+
+		RecordingFormat::BlockHeader header;
+		if (!header.Decode(buffer)) {
+			return false; // corrupt
+		}
+
+		try {
+			m_block.resize(static_cast<size_t>(header.storedSize));
+		}
+		catch (std::bad_alloc&) {
+			return false; // a single huge message, too big to be read here
+		}
+		if (!m_block.empty() && !ReadBytes(&m_block[0], m_block.size())) {
+			return false; // truncated
+		}
+
+		if (header.blockType != RecordingFormat::MessageBlock) {
+			continue; // not for us
+		}
+		if (header.compression != RecordingFormat::NoCompression) {
+			try {
+				RecordingFormat::DecompressPayload(header, m_block.data(), m_decompressed);
+			}
+			catch (std::exception&) {
+				return false; // corrupt, or too big to be decompressed here
+			}
+			m_position = m_decompressed.data();
+			m_end = m_position + m_decompressed.size();
+			return true;
+		}
+
+		m_position = m_block.data();
+		m_end = m_position + m_block.size();
+		return true;
+	}
+}
+
+bool MessageRecordingReader::Read(slaim::Message& msg, uint64_t* timestamp)
+{
+	if (m_legacy) {
+		if (timestamp) {
+			*timestamp = 0;
+		}
+		return ReadLegacy(msg);
+	}
+
+	while (m_position == m_end) {
+		if (!ReadBlock()) {
+			return false;
+		}
+	}
+
+	uint64_t recordTimestamp = 0;
+	const char* type = NULL;
+	const char* text = NULL;
+	size_t typeLength = 0, textLength = 0;
+	if (!RecordingFormat::DecodeRecord(m_position, m_end, recordTimestamp, type, typeLength, text, textLength)) {
+		m_position = m_end = NULL;
+		return false; // corrupt block
+	}
+
+	msg.m_type.assign(type, typeLength);
+	msg.m_text.assign(text, textLength);
+	if (timestamp) {
+		*timestamp = recordTimestamp;
+	}
+	return true;
+}
+
+bool MessageRecordingReader::SkipRecordsBefore(uint64_t timestamp)
+{
+	while (true) {
+		while (m_position == m_end) {
+			if (!ReadBlock()) {
+				return false;
+			}
+		}
+		const char* p = m_position;
+		uint64_t recordTimestamp = 0;
+		const char* type = NULL;
+		const char* text = NULL;
+		size_t typeLength = 0, textLength = 0;
+		if (!RecordingFormat::DecodeRecord(p, m_end, recordTimestamp, type, typeLength, text, textLength)) {
+			m_position = m_end = NULL;
+			return false; // corrupt block
+		}
+		if (recordTimestamp >= timestamp) {
+			return true;
+		}
+		m_position = p;
+	}
+}
+
+bool MessageRecordingReader::SeekToTime(uint64_t timestamp)
+{
+	if (m_legacy) {
+		return false; // no timestamps
+	}
+
+	RecordingIndex index;
+	if (index.Load(m_input)) {
+		const size_t i = index.FindBlock(timestamp);
+		if (i == index.GetEntries().size()) {
+			return false;
+		}
+		m_input.clear();
+		m_input.seekg(static_cast<std::streamoff>(index.GetEntries()[i].offset));
+		m_position = m_end = NULL;
+	}
+	else {
+		m_input.clear(); // Load may have hit the end of the stream
+	}
+
+	return SkipRecordsBefore(timestamp);
+}
+
+bool MessageRecordingReader::ReadLegacy(slaim::Message& msg)
+{
+	// see WriteMessageToStream
+	for (int i = 0; i < 2; ++i) {
+		int length = -1;
+		if (!ReadBytes(reinterpret_cast<char*>(&length), sizeof(length)) || length < 0 || (i == 0 && length == 0)) {
+			return false;
+		}
+		std::string& output = (i == 0) ? msg.m_type : msg.m_text;
+		output.resize(length);
+		if (!ReadBytes(&output[0], length)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+}
@@ -0,0 +1,245 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef CLAIM_MESSAGE_RECORDING_H
+#define CLAIM_MESSAGE_RECORDING_H
+
+#include <messaging/slaim/message.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace claim {
+
+//! The message recording format.
+/*! A recording consists of a file header followed by any number of blocks:
+
+	<pre>
+	file header  (32 bytes): magic "\x89NMR\r\n\x1a\n", version, flags, creation time, reserved
+	block header (48 bytes): magic "NMRB", block type, compression, message count,
+	                         stored size, raw size, first timestamp, last timestamp
+	block payload            (stored size bytes)
+	block header ...
+	</pre>
+
+	The payload of a message block is a sequence of records:
+
+	<pre>
+	uint64 timestamp (nanoseconds since 1970-01-01 UTC), uint32 type length, uint64 text length, type, text
+	</pre>
+
+	All integers are little-endian. Blocks are written with a single write call each, and
+	are independent of each other, so a reader can start from any block boundary.
+
+	The payload of a message block may be compressed (see Compression); raw size is then the size
+	of the decompressed payload. Each block is compressed independently of the others.
+
+	When a recording is closed, a time index (see RecordingIndex) is appended as an index
+	block, followed by a trailer block whose 8-byte payload is the offset of the index block.
+	The trailer thus always occupies the last trailerSize bytes of a closed recording.
+*/
+namespace RecordingFormat {
+	extern const char fileMagic[8];
+	const uint32_t blockMagic = 0x42524d4e; // "NMRB"
+	const uint32_t currentVersion = 1;
+
+	const size_t fileHeaderSize = 32;
+	const size_t blockHeaderSize = 48;
+	const size_t recordHeaderSize = 8 + 4 + 8;
+
+	const size_t trailerSize = blockHeaderSize + 8;
+
+	const size_t defaultBlockSize = 1024 * 1024;
+	// stored or raw; anything larger is taken to be corrupt, except for a block of a single message,
+	// which may be as large as the message needs (up to maxSingleMessageBlockSize)
+	const uint64_t maxBlockSize = 1024 * 1024 * 1024;
+	const uint64_t maxSingleMessageBlockSize = static_cast<uint64_t>(1) << 40;
+	const uint64_t maxBlockDuration = 1000000000; // nanoseconds
+
+	enum BlockType {
+		MessageBlock = 1,
+		IndexBlock = 2,
+		TrailerBlock = 3,
+	};
+
+	enum Compression {
+		NoCompression = 0,
+		ZlibCompression = 1, // available if built with CLAIM_HAVE_ZLIB
+	};
+
+	bool IsCompressionSupported(uint32_t compression);
+
+	struct FileHeader {
+		uint32_t version = currentVersion;
+		uint32_t flags = 0;
+		uint64_t creationTimestamp = 0;
+
+		void Encode(char* output) const; // writes fileHeaderSize bytes
+		bool Decode(const char* input);  // returns false if the magic does not match
+	};
+
+	struct BlockHeader {
+		uint32_t blockType = MessageBlock;
+		uint32_t compression = NoCompression;
+		uint32_t messageCount = 0;
+		uint64_t storedSize = 0;
+		uint64_t rawSize = 0;
+		uint64_t firstTimestamp = 0;
+		uint64_t lastTimestamp = 0;
+
+		void Encode(char* output) const; // writes blockHeaderSize bytes
+		bool Decode(const char* input);  // returns false if the magic does not match, or if a size is over the maximum
+	};
+
+	//! Decompresses the payload of a block. Throws std::runtime_error if it is corrupt, or if the
+	//! compression method is not supported. Reuses the capacity of raw.
+	void DecompressPayload(const BlockHeader& header, const char* stored, std::string& raw);
+
+	//! Parses the record at p, and advances p past it. Returns false if the data is truncated.
+	bool DecodeRecord(const char*& p, const char* end, uint64_t& timestamp, const char*& type, size_t& typeLength, const char*& text, size_t& textLength);
+
+	bool IsRecording(const char* firstBytes, size_t length);
+
+	void PutUInt32(char* p, uint32_t value);
+	void PutUInt64(char* p, uint64_t value);
+	uint32_t GetUInt32(const char* p);
+	uint64_t GetUInt64(const char* p);
+}
+
+//! Returns the current time as nanoseconds since 1970-01-01 UTC, i.e. as stored in the recordings.
+uint64_t GetRecordingTimestampNow();
+
+//! Accumulates records into a single contiguous block, header included.
+class RecordingBlockBuilder {
+public:
+	RecordingBlockBuilder();
+
+	//! Throws std::runtime_error if !HasRoomFor(msg).
+	void Append(const slaim::Message& msg, uint64_t timestamp);
+
+	//! Whether the message can be appended without making the block too big to be read back
+	//! (see RecordingFormat::maxBlockSize). An empty block has room for any realistic message.
+	bool HasRoomFor(const slaim::Message& msg) const;
+
+	bool IsEmpty() const { return m_header.messageCount == 0; }
+	size_t GetSize() const { return m_data.size(); } // header included
+	const RecordingFormat::BlockHeader& GetHeader() const { return m_header; }
+
+	//! Fills in the block header; after this, GetData() returns the complete block.
+	void Finish();
+	const std::string& GetData() const { return m_compressed ? m_compressedData : m_data; }
+
+	//! After Finish(), compresses the payload using zlib at the given level (1-9).
+	/*! If the payload does not get any smaller, it is left uncompressed.
+		Throws std::runtime_error if zlib is not available.
+	*/
+	void Compress(int level);
+
+	//! The uncompressed records, even after Compress(); GetHeader().rawSize bytes.
+	const char* GetRawPayload() const { return m_data.data() + RecordingFormat::blockHeaderSize; }
+
+	//! Starts a new block, but retains the allocated memory.
+	void Clear();
+
+	void Reserve(size_t size) { m_data.reserve(size); }
+
+	void Swap(RecordingBlockBuilder& that);
+
+private:
+	RecordingFormat::BlockHeader m_header;
+	std::string m_data;
+	std::string m_compressedData;
+	bool m_compressed;
+};
+
+class RecordingIndex;
+
+//! Writes messages to a stream in the recording format.
+class MessageRecordingWriter {
+public:
+	/*! \param output Should be opened in binary mode, and positioned at the beginning.
+		\param blockSize The block is written once it reaches (roughly) this size, or once it
+		                 spans RecordingFormat::maxBlockDuration.
+	*/
+	MessageRecordingWriter(std::ostream& output, size_t blockSize = RecordingFormat::defaultBlockSize);
+	~MessageRecordingWriter(); // closes
+
+	void Write(const slaim::Message& msg); // timestamped now
+	void Write(const slaim::Message& msg, uint64_t timestamp);
+
+	//! Writes the current block, even if it is not full yet.
+	void Flush();
+
+	//! Flushes, and writes the time index. Nothing can be written after this.
+	void Close();
+
+	//! Compresses the blocks using zlib at the given level (1-9); zero (the default) means no compression.
+	void SetCompressionLevel(int level) { m_compressionLevel = level; }
+
+	uint64_t GetMessageCount() const { return m_messageCount; }
+	uint64_t GetBytesWritten() const { return m_bytesWritten; }
+
+private:
+	// make the class non-copyable
+	MessageRecordingWriter(const MessageRecordingWriter&);
+	MessageRecordingWriter& operator= (const MessageRecordingWriter&);
+
+	std::ostream& m_output;
+	const size_t m_blockSize;
+	RecordingBlockBuilder m_block;
+	RecordingIndex* m_index;
+	uint64_t m_messageCount;
+	uint64_t m_bytesWritten;
+	bool m_closed;
+	int m_compressionLevel;
+};
+
+//! Reads messages from a stream in the recording format.
+/*! For compatibility, streams written using WriteMessageToStream (which have no header)
+	are read as well; their messages have no timestamps (zero is returned).
+*/
+class MessageRecordingReader {
+public:
+	//! \param input Should be opened in binary mode.
+	explicit MessageRecordingReader(std::istream& input);
+
+	//! Returns false at the end of the stream, or if the rest of the data is truncated or corrupt.
+	bool Read(slaim::Message& msg, uint64_t* timestamp = NULL);
+
+	//! Positions the reader at the first message whose timestamp is at or after the given one.
+	/*! Uses the time index, if there is one; otherwise, reads forward from the current position.
+		For the index, the stream needs to be seekable. Returns false if there is no such message.
+	*/
+	bool SeekToTime(uint64_t timestamp);
+
+	bool IsLegacyFormat() const { return m_legacy; }
+	const RecordingFormat::FileHeader& GetFileHeader() const { return m_fileHeader; }
+
+private:
+	bool ReadBytes(char* output, size_t length);
+	bool ReadBlock();
+	bool ReadLegacy(slaim::Message& msg);
+	bool SkipRecordsBefore(uint64_t timestamp);
+
+	std::istream& m_input;
+	std::string m_pending; // bytes that were read while detecting the format
+	size_t m_pendingPosition;
+
+	bool m_legacy;
+	RecordingFormat::FileHeader m_fileHeader;
+
+	std::vector<char> m_block;
+	std::string m_decompressed;
+	const char* m_position;
+	const char* m_end;
+};
+
+}
+
+#endif // CLAIM_MESSAGE_RECORDING_H
@@ -12,7 +12,8 @@
 #endif // WIN32
 
 #include "MessageStreaming.h"
-#include <vector>
+#include <algorithm>
+#include <cstring>
 #include <assert.h>
 
 namespace claim {
@@ -30,36 +31,116 @@ void WriteMessageToStream(std::ostream& output, const slaim::Message& msg)
 
 bool ReadMessageFromStream(std::istream& input, slaim::Message& msg)
 {
-	bool retval = false;
+	// read directly into the message, reusing the capacity of its strings
 	int len = -1;
 
 	input.read((char*) &len, sizeof(int));
-	if (len > 0) {
+	if (len > 0 && input.good()) {
 		try {
-			std::vector<char> buf(len);
-			input.read(&buf[0], len);
+			msg.m_type.resize(len);
+			input.read(&msg.m_type[0], len);
 			if (input.good()) {
-				msg.m_type = std::string(&buf[0], len);
-				
 				len = -1;
 				input.read((char*) &len, sizeof(int));
-				if (len > 0) {
-					buf.resize(len);
-					input.read(&buf[0], len);
-					msg.m_text = std::string(&buf[0], len);
-
-					if (input.good()) {
-						retval = true;
-					}
+				if (len > 0 && input.good()) {
+					msg.m_text.resize(len);
+					input.read(&msg.m_text[0], len);
+					return input.good();
 				}
 			}
 		}
 		catch (...) {
-			retval = false;
 		}
 	}
 
-	return retval;
+	return false;
+}
+
+MessageStreamReader::MessageStreamReader(std::istream& input, size_t bufferSize)
+	: m_input(input)
+	, m_buffer((std::max)(bufferSize, sizeof(int)))
+	, m_position(0)
+	, m_end(0)
+	, m_bufferPosition(0)
+	, m_messagePosition(0)
+	, m_status(Ok)
+{}
+
+bool MessageStreamReader::Fill(size_t length)
+{
+	if (GetAvailable() >= length) {
+		return true;
+	}
+	assert(length <= m_buffer.size());
+
+	// move the remaining bytes to the beginning, and read as much as fits after them
+	if (m_position > 0) {
+		memmove(&m_buffer[0], &m_buffer[m_position], GetAvailable());
+		m_bufferPosition += m_position;
+		m_end -= m_position;
+		m_position = 0;
+	}
+	while (m_end < length && m_input) {
+		m_input.read(&m_buffer[m_end], static_cast<std::streamsize>(m_buffer.size() - m_end));
+		m_end += static_cast<size_t>(m_input.gcount());
+	}
+	return m_end >= length;
+}
+
+MessageStreamReader::Status MessageStreamReader::ReadField(std::string& field, bool allowEmpty)
+{
+	if (!Fill(sizeof(int))) {
+		return Truncated;
+	}
+	int length = -1;
+	memcpy(&length, &m_buffer[m_position], sizeof(int));
+	m_position += sizeof(int);
+	if (length < 0 || (length == 0 && !allowEmpty)) {
+		return Corrupt;
+	}
+
+	const size_t size = static_cast<size_t>(length);
+	if (size <= m_buffer.size()) {
+		if (!Fill(size)) {
+			return Truncated;
+		}
+		field.assign(&m_buffer[m_position], size);
+		m_position += size;
+		return Ok;
+	}
+
+	// larger than the buffer: take what is buffered, and read the rest directly
+	const size_t buffered = GetAvailable();
+	field.resize(size);
+	memcpy(&field[0], &m_buffer[m_position], buffered);
+	m_position = m_end;
+	m_input.read(&field[buffered], static_cast<std::streamsize>(size - buffered));
+	const size_t n = static_cast<size_t>(m_input.gcount());
+	m_bufferPosition += n;
+	return buffered + n == size ? Ok : Truncated;
+}
+
+MessageStreamReader::Status MessageStreamReader::Read(slaim::Message& msg)
+{
+	if (m_status != Ok) {
+		return m_status;
+	}
+
+	m_messagePosition = m_bufferPosition + m_position;
+
+	if (!Fill(sizeof(int))) {
+		m_status = GetAvailable() == 0 ? EndOfStream : Truncated;
+		return m_status;
+	}
+
+	m_status = ReadField(msg.m_type, false);
+	if (m_status == Ok) {
+		m_status = ReadField(msg.m_text, true);
+	}
+	if (m_status == Ok) {
+		m_messagePosition = m_bufferPosition + m_position;
+	}
+	return m_status;
 }
 
 }
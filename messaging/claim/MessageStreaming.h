@@ -11,12 +11,69 @@
 
 #include <messaging/slaim/message.h>
 #include <iostream>
+#include <vector>
+#include <cstdint>
 
 namespace claim {
 
+//! The original, headerless recording format: no timestamps, and lengths limited to 2 GB.
+/*! New recordings should rather use MessageRecordingWriter (see MessageRecording.h), 
+	whose reader can read this format, too.
+*/
 void WriteMessageToStream(std::ostream& output, const slaim::Message& msg);
 bool ReadMessageFromStream(std::istream& input, slaim::Message& msg);
 
+//! Reads streams written using WriteMessageToStream, through a large buffer of its own.
+/*! Unlike ReadMessageFromStream, does not allocate anything per message: the messages are
+	decoded into the caller's object, reusing the capacity of its strings. So passing
+	the same object to every call makes reading allocation-free in the steady state:
+	<pre>
+	claim::MessageStreamReader reader(input);
+	slaim::Message msg;
+	while (reader.Read(msg) == claim::MessageStreamReader::Ok) {
+		...
+	}
+	</pre>
+	The buffer is filled with a single istream::read call at a time, so the reader
+	should not be used for streams that need to be consumed message by message (pipes).
+*/
+class MessageStreamReader {
+public:
+	enum Status {
+		Ok,
+		EndOfStream, // cleanly, between two messages
+		Truncated,   // the stream ends in the middle of a message
+		Corrupt,     // a negative length, or an empty type
+	};
+
+	static const size_t defaultBufferSize = 256 * 1024;
+
+	explicit MessageStreamReader(std::istream& input, size_t bufferSize = defaultBufferSize);
+
+	//! Once anything but Ok is returned, the same status is returned from then on.
+	Status Read(slaim::Message& msg);
+
+	//! The offset of the next message from where the reader started; after an error, of the failed one.
+	uint64_t GetPosition() const { return m_messagePosition; }
+
+private:
+	// make the class non-copyable
+	MessageStreamReader(const MessageStreamReader&);
+	MessageStreamReader& operator= (const MessageStreamReader&);
+
+	bool Fill(size_t length); // makes sure that (at least) length bytes are buffered
+	Status ReadField(std::string& field, bool allowEmpty);
+	size_t GetAvailable() const { return m_end - m_position; }
+
+	std::istream& m_input;
+	std::vector<char> m_buffer;
+	size_t m_position;
+	size_t m_end;
+	uint64_t m_bufferPosition; // the stream offset of m_buffer[0]
+	uint64_t m_messagePosition;
+	Status m_status;
+};
+
 }
 
 #endif // CLAIM_MESSAGE_STREAMING_H
@@ -0,0 +1,181 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef WIN32
+#pragma warning (disable: 4786)
+#endif // WIN32
+
+#include "ParallelAttributeMessageDecoder.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+namespace {
+	// for smaller batches, waking up the workers costs more than it saves
+	const size_t minimumParallelBatchSize = 256;
+	const size_t minimumChunkSize = 64;
+
+	// The elements are reused from batch to batch, but the assignment keeps the attributes (and
+	// the body) of the previous message if the new one has none, so they are cleared first.
+	void DecodeInto(const slaim::Message& src, claim::AttributeMessage& decoded)
+	{
+		decoded.m_attributes.clear();
+		decoded.m_body.clear();
+		decoded = src;
+	}
+}
+
+namespace claim {
+
+class ParallelAttributeMessageDecoder::Impl {
+public:
+	void RunWorker();
+	void ProcessChunks();
+
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable jobDone;
+	unsigned long long generation = 0;
+	size_t activeWorkers = 0;
+	bool killed = false;
+	std::exception_ptr exception;
+
+	// the current job
+	const std::vector<slaim::Message>* src = NULL;
+	std::vector<AttributeMessage>* decoded = NULL;
+	size_t chunkSize = 0;
+	std::atomic<size_t> nextIndex;
+};
+
+void ParallelAttributeMessageDecoder::Impl::RunWorker()
+{
+	unsigned long long seenGeneration = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [&]() { return killed || generation != seenGeneration; });
+			if (killed) {
+				return;
+			}
+			seenGeneration = generation;
+		}
+
+		try {
+			ProcessChunks();
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			exception = std::current_exception();
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--activeWorkers == 0) {
+			jobDone.notify_one();
+		}
+	}
+}
+
+void ParallelAttributeMessageDecoder::Impl::ProcessChunks()
+{
+	const size_t n = src->size();
+	while (true) {
+		const size_t begin = nextIndex.fetch_add(chunkSize);
+		if (begin >= n) {
+			break;
+		}
+		const size_t end = (std::min)(n, begin + chunkSize);
+		for (size_t i = begin; i < end; ++i) {
+			DecodeInto((*src)[i], (*decoded)[i]);
+		}
+	}
+}
+
+ParallelAttributeMessageDecoder::ParallelAttributeMessageDecoder(unsigned int threadCount)
+{
+	pimpl_ = new Impl;
+
+	if (threadCount == 0) {
+		threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	}
+
+	// the calling thread does its share of the work, too
+	for (unsigned int i = 1; i < threadCount; ++i) {
+		pimpl_->workers.push_back(std::thread(&Impl::RunWorker, pimpl_));
+	}
+}
+
+ParallelAttributeMessageDecoder::~ParallelAttributeMessageDecoder()
+{
+	{
+		std::lock_guard<std::mutex> lock(pimpl_->mutex);
+		pimpl_->killed = true;
+	}
+	pimpl_->jobAvailable.notify_all();
+	for (std::thread& worker : pimpl_->workers) {
+		worker.join();
+	}
+	delete pimpl_;
+}
+
+unsigned int ParallelAttributeMessageDecoder::GetThreadCount() const
+{
+	return static_cast<unsigned int>(pimpl_->workers.size() + 1);
+}
+
+void ParallelAttributeMessageDecoder::Decode(const std::vector<slaim::Message>& src, std::vector<AttributeMessage>& decoded)
+{
+	const size_t n = src.size();
+	decoded.resize(n);
+
+	if (pimpl_->workers.empty() || n < minimumParallelBatchSize) {
+		for (size_t i = 0; i < n; ++i) {
+			DecodeInto(src[i], decoded[i]);
+		}
+		return;
+	}
+
+	const size_t threadCount = pimpl_->workers.size() + 1;
+
+	{
+		std::lock_guard<std::mutex> lock(pimpl_->mutex);
+		pimpl_->src = &src;
+		pimpl_->decoded = &decoded;
+		// a few chunks per thread, so that an occasional huge message does not stall the whole batch
+		pimpl_->chunkSize = (std::max)(minimumChunkSize, n / (4 * threadCount));
+		pimpl_->nextIndex = 0;
+		pimpl_->activeWorkers = pimpl_->workers.size();
+		pimpl_->exception = std::exception_ptr();
+		++pimpl_->generation;
+	}
+	pimpl_->jobAvailable.notify_all();
+
+	std::exception_ptr exception;
+	try {
+		pimpl_->ProcessChunks();
+	}
+	catch (...) {
+		exception = std::current_exception();
+	}
+
+	std::unique_lock<std::mutex> lock(pimpl_->mutex);
+	pimpl_->jobDone.wait(lock, [this]() { return pimpl_->activeWorkers == 0; });
+
+	if (!exception) {
+		exception = pimpl_->exception;
+	}
+	if (exception) {
+		std::rethrow_exception(exception);
+	}
+}
+
+}
@@ -0,0 +1,62 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef CLAIM_PARALLEL_ATTRIBUTE_MESSAGE_DECODER_H
+#define CLAIM_PARALLEL_ATTRIBUTE_MESSAGE_DECODER_H
+
+#include "AttributeMessage.h"
+
+#include <vector>
+
+namespace claim {
+
+//! Decodes batches of raw messages into AttributeMessages using a pool of worker threads.
+/*! Meant to be combined with slaim::PostOffice::ReceiveBatch, e.g.:
+	<pre>
+	std::vector<slaim::Message> msgs;
+	std::vector<claim::AttributeMessage> amsgs;
+	while (...) {
+		msgs.clear();
+		postOffice.ReceiveBatch(msgs, 100000, 1.0);
+		decoder.Decode(msgs, amsgs);
+		...
+	}
+	</pre>
+	Each worker allocates the decoded strings from its own thread (and so, with
+	most malloc implementations, from its own arena), and works on contiguous chunks
+	of the batch, so the workers hardly ever contend for the same locks or cache lines.
+	The workers are shared by all the calls, so one instance must not be used from several
+	threads at once; use an instance per thread instead.
+*/
+class ParallelAttributeMessageDecoder {
+public:
+	/*! \param threadCount The number of threads used for decoding, including the calling thread.
+		       If zero, the number of hardware threads is used.
+	*/
+	explicit ParallelAttributeMessageDecoder(unsigned int threadCount = 0);
+	~ParallelAttributeMessageDecoder();
+
+	//! Decodes src[i] into decoded[i], for each i. The order is preserved.
+	/*! The vector is resized to src.size(). Its existing elements are reused, so passing
+		the same vector on every call avoids some re-allocation.
+	*/
+	void Decode(const std::vector<slaim::Message>& src, std::vector<AttributeMessage>& decoded);
+
+	unsigned int GetThreadCount() const;
+
+private:
+	// make the class non-copyable
+	ParallelAttributeMessageDecoder(const ParallelAttributeMessageDecoder&);
+	ParallelAttributeMessageDecoder& operator= (const ParallelAttributeMessageDecoder&);
+
+	class Impl;
+	Impl* pimpl_;
+};
+
+}
+
+#endif // CLAIM_PARALLEL_ATTRIBUTE_MESSAGE_DECODER_H
@@ -53,10 +53,8 @@ std::shared_ptr<slaim::PostOffice> CreatePostOffice(PostOfficeInitializer& initi
 
 	std::string connectInfo = oss.str();
 
-	auto postOffice = std::make_shared<numrabw::PostOffice>(connectInfo, clientIdentifier);
-	postOffice->ReadSettings(initializer);
-
-	return postOffice;
+	// the settings are read before the threads are started
+	return std::make_shared<numrabw::PostOffice>(connectInfo, clientIdentifier, initializer);
 }
 
 class PostOffice::Impl {
@@ -113,12 +111,36 @@ bool PostOffice::Send(const slaim::Message& msg)
 	return pimpl_->postOffice->Send(msg);
 }
 
+size_t PostOffice::SendBatch(const std::vector<slaim::Message>& msgs, size_t first)
+{
+	CheckInitialized();
+	return pimpl_->postOffice->SendBatch(msgs, first);
+}
+
+bool PostOffice::Flush(double maxSecondsToWait)
+{
+	CheckInitialized();
+	return pimpl_->postOffice->Flush(maxSecondsToWait);
+}
+
 bool PostOffice::Receive(slaim::Message& msg, double maxSecondsToWait)
 {
 	CheckInitialized();
 	return pimpl_->postOffice->Receive(msg, maxSecondsToWait); 
 }
 
+size_t PostOffice::ReceiveBatch(std::vector<slaim::Message>& msgs, size_t maxCount, double maxSecondsToWait)
+{
+	CheckInitialized();
+	return pimpl_->postOffice->ReceiveBatch(msgs, maxCount, maxSecondsToWait);
+}
+
+size_t PostOffice::ReceiveAll(std::deque<slaim::Message>& msgs, double maxSecondsToWait)
+{
+	CheckInitialized();
+	return pimpl_->postOffice->ReceiveAll(msgs, maxSecondsToWait);
+}
+
 std::string PostOffice::GetClientAddress() const
 {
 	CheckInitialized();
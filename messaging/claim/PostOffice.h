@@ -42,7 +42,11 @@ public:
 	virtual void Subscribe(const slaim::MessageType& t);
 	virtual void Unsubscribe(const slaim::MessageType& t);
 	virtual bool Send(const slaim::Message& msg);
+	virtual size_t SendBatch(const std::vector<slaim::Message>& msgs, size_t first = 0);
+	virtual bool Flush(double maxSecondsToWait);
 	virtual bool Receive(slaim::Message& msg, double maxSecondsToWait = 0);
+	virtual size_t ReceiveBatch(std::vector<slaim::Message>& msgs, size_t maxCount, double maxSecondsToWait = 0);
+	virtual size_t ReceiveAll(std::deque<slaim::Message>& msgs, double maxSecondsToWait = 0);
 
 	virtual std::string GetClientAddress() const;
 	virtual const char* GetVersion() const;
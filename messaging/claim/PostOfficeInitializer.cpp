@@ -10,6 +10,106 @@
 
 namespace claim {
 
+std::string PostOfficeInitializer::GetReceiveBufferMode()
+{
+	return "locked";
+}
+
+std::string PostOfficeInitializer::GetSendBufferMode()
+{
+	return "locked";
+}
+
+bool PostOfficeInitializer::GetBufferLimitsAllocatedBytes()
+{
+	return false;
+}
+
+unsigned int PostOfficeInitializer::GetBufferShrinkSeconds()
+{
+	return 10;
+}
+
+bool PostOfficeInitializer::GetTrimHeapAfterBurst()
+{
+	return false;
+}
+
+unsigned int PostOfficeInitializer::GetReceiveBufferSpinMicroseconds()
+{
+	return 0;
+}
+
+unsigned int PostOfficeInitializer::GetSendBufferSpinMicroseconds()
+{
+	return 0;
+}
+
+unsigned int PostOfficeInitializer::GetReceiverPollMilliseconds()
+{
+	return 100;
+}
+
+unsigned int PostOfficeInitializer::GetReceiverHeartbeatSeconds()
+{
+	return 60;
+}
+
+unsigned int PostOfficeInitializer::GetReceivePrefetchCount()
+{
+	return 0;
+}
+
+size_t PostOfficeInitializer::GetSendBatchMaxMessages()
+{
+	return 1024;
+}
+
+double PostOfficeInitializer::GetSendBatchMaxMegabytes()
+{
+	return 1;
+}
+
+unsigned int PostOfficeInitializer::GetSendBatchLingerMicroseconds()
+{
+	return 0;
+}
+
+size_t PostOfficeInitializer::GetSendConfirmWindow()
+{
+	return 0;
+}
+
+size_t PostOfficeInitializer::GetReceiveBufferMaxItemCountPerType()
+{
+	return 0;
+}
+
+double PostOfficeInitializer::GetReceiveBufferMaxMegabytesPerType()
+{
+	return 64;
+}
+
+std::string PostOfficeInitializer::GetReceiveBufferTypeQuotas()
+{
+	return "";
+}
+
+std::string PostOfficeInitializer::GetSendSpillDirectory()
+{
+	return "";
+}
+
+double PostOfficeInitializer::GetSendSpillMaxMegabytes()
+{
+	return 10240;
+}
+
+unsigned int PostOfficeInitializer::GetSendSpillDrainMessagesPerSecond()
+{
+	return 10000;
+}
+
 std::string DefaultPostOfficeInitializer::GetMessagingServerHost()
 { 
 #ifdef WIN32
@@ -121,4 +221,104 @@ double IniFilePostOfficeInitializer::GetSendBufferMaxMegabytes()
 	return sendBufferMaxMegabytes;
 }
 
+std::string IniFilePostOfficeInitializer::GetReceiveBufferMode()
+{
+	return iniFile.GetSetValue("PostOffice", "ReceiveBufferMode", "locked", "locked = messages may be received from any number of threads; spsc = lock-free, but from a single thread only.");
+}
+
+std::string IniFilePostOfficeInitializer::GetSendBufferMode()
+{
+	return iniFile.GetSetValue("PostOffice", "SendBufferMode", "locked", "locked = messages may be sent from any number of threads; spsc = lock-free, but from a single thread only; mpsc = lock-free, from any number of threads.");
+}
+
+bool IniFilePostOfficeInitializer::GetBufferLimitsAllocatedBytes()
+{
+	return iniFile.GetSetValue("PostOffice", "BufferLimitsAllocatedBytes", 0, "1 = ReceiveBufferMaxMegabytes and SendBufferMaxMegabytes limit the memory taken by the buffered messages (estimated), which for small messages is several times their size; 0 = the size of the message contents only.") > 0;
+}
+
+unsigned int IniFilePostOfficeInitializer::GetBufferShrinkSeconds()
+{
+	return static_cast<unsigned int>(iniFile.GetSetValue("PostOffice", "BufferShrinkSeconds", 10, "After a burst, once the buffers have held at most 1024 messages for this long, the memory they needed for the burst is released. 0 = never."));
+}
+
+bool IniFilePostOfficeInitializer::GetTrimHeapAfterBurst()
+{
+	return iniFile.GetSetValue("PostOffice", "TrimHeapAfterBurst", 0, "1 = after a burst, once the buffers have been released, return the free memory of the heap to the operating system as well (malloc_trim on glibc, _heapmin on Windows), so that the resident size goes back down.") > 0;
+}
+
+unsigned int IniFilePostOfficeInitializer::GetReceiveBufferSpinMicroseconds()
+{
+	return static_cast<unsigned int>(iniFile.GetSetValue("PostOffice", "ReceiveBufferSpinMicroseconds", 0, "How long a thread waiting to receive messages polls the buffer before going to sleep; lower latency, but burns a core. 0 = no polling."));
+}
+
+unsigned int IniFilePostOfficeInitializer::GetSendBufferSpinMicroseconds()
+{
+	return static_cast<unsigned int>(iniFile.GetSetValue("PostOffice", "SendBufferSpinMicroseconds", 0, "How long the sender thread polls the send buffer before going to sleep; lower latency, but burns a core. 0 = no polling."));
+}
+
+unsigned int IniFilePostOfficeInitializer::GetReceiverPollMilliseconds()
+{
+	return static_cast<unsigned int>(iniFile.GetSetValue("PostOffice", "ReceiverPollMilliseconds", 100, "How long the receiver thread waits for messages at a time before checking for subscription changes and for quitting."));
+}
+
+unsigned int IniFilePostOfficeInitializer::GetReceiverHeartbeatSeconds()
+{
+	return static_cast<unsigned int>(iniFile.GetSetValue("PostOffice", "ReceiverHeartbeatSeconds", 60, "Heartbeat interval of the receiver's connection, so that a broken connection is noticed even when no messages arrive; takes effect when reconnecting. 0 = no heartbeats."));
+}
+
+unsigned int IniFilePostOfficeInitializer::GetReceivePrefetchCount()
+{
+	return static_cast<unsigned int>(iniFile.GetSetValue("PostOffice", "ReceivePrefetchCount", 0, "With acknowledged consumption, the maximum number of messages that the broker sends before the application has taken the earlier ones from the receiving buffer (at most 65535); keeps a slow application from filling the buffer. Takes effect when connecting. 0 = no acks."));
+}
+
+size_t IniFilePostOfficeInitializer::GetSendBatchMaxMessages()
+{
+	return static_cast<size_t>(iniFile.GetSetValue("PostOffice", "SendBatchMaxMessages", 1024, "Maximum number of messages that the sender thread publishes in a row."));
+}
+
+double IniFilePostOfficeInitializer::GetSendBatchMaxMegabytes()
+{
+	return iniFile.GetSetValue("PostOffice", "SendBatchMaxMegabytes", 1, "Maximum size in megabytes of the messages that the sender thread publishes in a row.");
+}
+
+unsigned int IniFilePostOfficeInitializer::GetSendBatchLingerMicroseconds()
+{
+	return static_cast<unsigned int>(iniFile.GetSetValue("PostOffice", "SendBatchLingerMicroseconds", 0, "When there are fewer messages to send than SendBatchMaxMessages, how long the sender thread waits for more before publishing them; adds to the latency, but saves a wakeup per message at moderate rates. 0 = no waiting."));
+}
+
+size_t IniFilePostOfficeInitializer::GetSendConfirmWindow()
+{
+	return static_cast<size_t>(iniFile.GetSetValue("PostOffice", "SendConfirmWindow", 0, "With publisher confirms, the maximum number of published messages that the broker has not confirmed yet; the unconfirmed messages are published again after a reconnect. Takes effect when connecting. 0 = no confirms."));
+}
+
+size_t IniFilePostOfficeInitializer::GetReceiveBufferMaxItemCountPerType()
+{
+	return static_cast<size_t>(iniFile.GetSetValue("PostOffice", "ReceiveBufferMaxItemCountPerType", 0, "Maximum item count per message type in the receiving buffer; messages over the quota are dropped, so that other types are not delayed. 0 = no per-type quotas."));
+}
+
+double IniFilePostOfficeInitializer::GetReceiveBufferMaxMegabytesPerType()
+{
+	return iniFile.GetSetValue("PostOffice", "ReceiveBufferMaxMegabytesPerType", 64, "Maximum size in megabytes per message type in the receiving buffer.");
+}
+
+std::string IniFilePostOfficeInitializer::GetReceiveBufferTypeQuotas()
+{
+	return iniFile.GetSetValue("PostOffice", "ReceiveBufferTypeQuotas", "", "Quotas for individual message types, as type=items/megabytes/weight, separated by commas. A type of weight 2 gets twice as many messages delivered per round as the others.");
+}
+
+std::string IniFilePostOfficeInitializer::GetSendSpillDirectory()
+{
+	return iniFile.GetSetValue("PostOffice", "SendSpillDirectory", "", "While the connection is down, messages to be sent are spilled to files in this directory, and sent in order once the connection is back. Empty = no spilling; messages are kept in memory only.");
+}
+
+double IniFilePostOfficeInitializer::GetSendSpillMaxMegabytes()
+{
+	return iniFile.GetSetValue("PostOffice", "SendSpillMaxMegabytes", 10240, "Maximum size in megabytes of the spilled messages on disk.");
+}
+
+unsigned int IniFilePostOfficeInitializer::GetSendSpillDrainMessagesPerSecond()
+{
+	return static_cast<unsigned int>(iniFile.GetSetValue("PostOffice", "SendSpillDrainMessagesPerSecond", 10000, "The rate at which spilled messages are sent once the connection is back, so that reconnecting does not cause a publish storm; should exceed the normal send rate. 0 = no limit."));
+}
+
 }
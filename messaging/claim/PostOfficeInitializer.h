@@ -26,6 +26,61 @@ public:
 	virtual double GetReceiveBufferMaxMegabytes() = 0;
 	virtual size_t GetSendBufferMaxItemCount() = 0;
 	virtual double GetSendBufferMaxMegabytes() = 0;	
+
+	// the settings below have defaults (those of DefaultPostOfficeInitializer), so that
+	// initializers written before they were added need not implement them
+
+	// "locked" (any number of threads), "spsc" (lock-free, but only one thread may receive or send),
+	// or "mpsc" (lock-free, any number of threads may send, but only one may receive)
+	virtual std::string GetReceiveBufferMode();
+	virtual std::string GetSendBufferMode();
+
+	// whether the buffers' maximum megabytes limit the memory that the messages take (estimated,
+	// including the overhead of each message), rather than just the size of their contents
+	virtual bool GetBufferLimitsAllocatedBytes();
+
+	// after a burst, once the buffers have stayed nearly empty for this long, their spare storage
+	// is released (0 = never); optionally, free heap memory is then returned to the OS as well
+	virtual unsigned int GetBufferShrinkSeconds();
+	virtual bool GetTrimHeapAfterBurst();
+
+	// how long a thread waiting for messages polls before going to sleep (0 = not at all)
+	virtual unsigned int GetReceiveBufferSpinMicroseconds();
+	virtual unsigned int GetSendBufferSpinMicroseconds();
+
+	// the receiver thread waits for messages at most this long at a time before checking for
+	// subscription changes and for quitting; heartbeats let both the broker and the receiver
+	// notice a broken connection even when no messages arrive (0 = no heartbeats)
+	virtual unsigned int GetReceiverPollMilliseconds();
+	virtual unsigned int GetReceiverHeartbeatSeconds();
+
+	// with acknowledged consumption, the broker sends at most so many messages before the
+	// application has taken the earlier ones from the receive buffer (0 = no acks)
+	virtual unsigned int GetReceivePrefetchCount();
+
+	// the sender publishes at most so many messages (or bytes) in a row before checking for other
+	// things to do; with a linger time, it waits that long for more messages to come along when
+	// it has only a few, instead of waking up for each one (0 = no waiting, for the lowest latency)
+	virtual size_t GetSendBatchMaxMessages();
+	virtual double GetSendBatchMaxMegabytes();
+	virtual unsigned int GetSendBatchLingerMicroseconds();
+
+	// with publisher confirms, the sender keeps up to so many published messages until the broker
+	// confirms them, and publishes them again after a reconnect (0 = no confirms)
+	virtual size_t GetSendConfirmWindow();
+
+	// per-type quotas for the receive buffer (0 items = none), so that one busy message type
+	// cannot crowd out the others; messages over their type's quota are dropped
+	virtual size_t GetReceiveBufferMaxItemCountPerType();
+	virtual double GetReceiveBufferMaxMegabytesPerType();
+	// overrides for individual types: "type=items/megabytes/weight, ..." (the weight is optional)
+	virtual std::string GetReceiveBufferTypeQuotas();
+
+	// while the connection is down, messages to be sent are spilled to this directory ("" = not at all),
+	// and sent in order once the connection is back, at most so many per second (0 = no limit)
+	virtual std::string GetSendSpillDirectory();
+	virtual double GetSendSpillMaxMegabytes();
+	virtual unsigned int GetSendSpillDrainMessagesPerSecond();
 };
 
 class DefaultPostOfficeInitializer : public PostOfficeInitializer
@@ -59,6 +114,33 @@ public:
 	virtual size_t GetSendBufferMaxItemCount() override;
 	virtual double GetSendBufferMaxMegabytes() override;
 
+	virtual std::string GetReceiveBufferMode() override;
+	virtual std::string GetSendBufferMode() override;
+
+	virtual bool GetBufferLimitsAllocatedBytes() override;
+	virtual unsigned int GetBufferShrinkSeconds() override;
+	virtual bool GetTrimHeapAfterBurst() override;
+
+	virtual unsigned int GetReceiveBufferSpinMicroseconds() override;
+	virtual unsigned int GetSendBufferSpinMicroseconds() override;
+
+	virtual unsigned int GetReceiverPollMilliseconds() override;
+	virtual unsigned int GetReceiverHeartbeatSeconds() override;
+	virtual unsigned int GetReceivePrefetchCount() override;
+
+	virtual size_t GetSendBatchMaxMessages() override;
+	virtual double GetSendBatchMaxMegabytes() override;
+	virtual unsigned int GetSendBatchLingerMicroseconds() override;
+	virtual size_t GetSendConfirmWindow() override;
+
+	virtual size_t GetReceiveBufferMaxItemCountPerType() override;
+	virtual double GetReceiveBufferMaxMegabytesPerType() override;
+	virtual std::string GetReceiveBufferTypeQuotas() override;
+
+	virtual std::string GetSendSpillDirectory() override;
+	virtual double GetSendSpillMaxMegabytes() override;
+	virtual unsigned int GetSendSpillDrainMessagesPerSecond() override;
+
 private:
 	numcfc::IniFile& iniFile;
 };
@@ -0,0 +1,355 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef WIN32
+#pragma warning (disable: 4786)
+#endif // WIN32
+
+#include "RecordingIndex.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace claim {
+
+using namespace RecordingFormat;
+
+// The payload of an index block:
+//
+//   uint32 type count, { uint32 length, type }
+//   uint64 entry count, { uint64 offset, uint64 first timestamp, uint64 last timestamp,
+//                         uint32 message count, uint32 type count, { uint32 type id, uint32 message count } }
+
+void RecordingIndex::AddMessage(const std::string& type)
+{
+	std::unordered_map<std::string, uint32_t>::const_iterator i = m_typeIds.find(type);
+	uint32_t typeId = 0;
+	if (i == m_typeIds.end()) {
+		typeId = static_cast<uint32_t>(m_types.size());
+		m_types.push_back(type);
+		m_typeIds[type] = typeId;
+		m_currentCounts.push_back(0);
+	}
+	else {
+		typeId = i->second;
+	}
+	++m_currentCounts[typeId];
+}
+
+void RecordingIndex::FinishBlock(uint64_t offset, const BlockHeader& header)
+{
+	Entry entry;
+	entry.offset = offset;
+	entry.firstTimestamp = header.firstTimestamp;
+	entry.lastTimestamp = header.lastTimestamp;
+	entry.messageCount = header.messageCount;
+	for (size_t typeId = 0, end = m_currentCounts.size(); typeId < end; ++typeId) {
+		if (m_currentCounts[typeId] > 0) {
+			entry.typeCounts.push_back(std::make_pair(static_cast<uint32_t>(typeId), m_currentCounts[typeId]));
+			m_currentCounts[typeId] = 0;
+		}
+	}
+	AddEntry(entry);
+}
+
+void RecordingIndex::AddEntry(Entry& entry)
+{
+	entry.maxLastTimestamp = m_entries.empty()
+		? entry.lastTimestamp
+		: (std::max)(entry.lastTimestamp, m_entries.back().maxLastTimestamp);
+	m_entries.push_back(std::move(entry));
+}
+
+size_t RecordingIndex::GetFooterSize() const
+{
+	size_t payloadSize = 4 + 8;
+	for (size_t i = 0, end = m_types.size(); i < end; ++i) {
+		payloadSize += 4 + m_types[i].length();
+	}
+	for (size_t i = 0, end = m_entries.size(); i < end; ++i) {
+		payloadSize += 8 + 8 + 8 + 4 + 4 + m_entries[i].typeCounts.size() * 8;
+	}
+	return blockHeaderSize + payloadSize + trailerSize;
+}
+
+void RecordingIndex::EncodeFooter(uint64_t indexOffset, std::string& output) const
+{
+	output.resize(GetFooterSize());
+	char* p = &output[blockHeaderSize];
+
+	PutUInt32(p, static_cast<uint32_t>(m_types.size()));
+	p += 4;
+	for (size_t i = 0, end = m_types.size(); i < end; ++i) {
+		const std::string& type = m_types[i];
+		PutUInt32(p, static_cast<uint32_t>(type.length()));
+		memcpy(p + 4, type.data(), type.length());
+		p += 4 + type.length();
+	}
+
+	PutUInt64(p, m_entries.size());
+	p += 8;
+	for (size_t i = 0, end = m_entries.size(); i < end; ++i) {
+		const Entry& entry = m_entries[i];
+		PutUInt64(p, entry.offset);
+		PutUInt64(p + 8, entry.firstTimestamp);
+		PutUInt64(p + 16, entry.lastTimestamp);
+		PutUInt32(p + 24, entry.messageCount);
+		PutUInt32(p + 28, static_cast<uint32_t>(entry.typeCounts.size()));
+		p += 32;
+		for (size_t j = 0, typeCount = entry.typeCounts.size(); j < typeCount; ++j) {
+			PutUInt32(p, entry.typeCounts[j].first);
+			PutUInt32(p + 4, entry.typeCounts[j].second);
+			p += 8;
+		}
+	}
+
+	BlockHeader indexHeader;
+	indexHeader.blockType = IndexBlock;
+	indexHeader.storedSize = indexHeader.rawSize = p - &output[blockHeaderSize];
+	if (!m_entries.empty()) {
+		indexHeader.firstTimestamp = m_entries.front().firstTimestamp;
+		indexHeader.lastTimestamp = m_entries.back().maxLastTimestamp;
+	}
+	indexHeader.Encode(&output[0]);
+
+	BlockHeader trailerHeader;
+	trailerHeader.blockType = TrailerBlock;
+	trailerHeader.storedSize = trailerHeader.rawSize = 8;
+	trailerHeader.Encode(p);
+	PutUInt64(p + blockHeaderSize, indexOffset);
+}
+
+bool RecordingIndex::Decode(const char* payload, size_t size)
+{
+	Clear();
+
+	const char* p = payload;
+	const char* end = payload + size;
+
+	if (end - p < 4) {
+		return false;
+	}
+	const uint32_t typeCount = GetUInt32(p);
+	p += 4;
+	for (uint32_t i = 0; i < typeCount; ++i) {
+		if (end - p < 4) {
+			return false;
+		}
+		const uint32_t length = GetUInt32(p);
+		p += 4;
+		if (static_cast<size_t>(end - p) < length) {
+			return false;
+		}
+		m_types.push_back(std::string(p, length));
+		m_typeIds[m_types.back()] = i;
+		p += length;
+	}
+
+	if (end - p < 8) {
+		return false;
+	}
+	const uint64_t entryCount = GetUInt64(p);
+	p += 8;
+	for (uint64_t i = 0; i < entryCount; ++i) {
+		if (end - p < 32) {
+			return false;
+		}
+		Entry entry;
+		entry.offset = GetUInt64(p);
+		entry.firstTimestamp = GetUInt64(p + 8);
+		entry.lastTimestamp = GetUInt64(p + 16);
+		entry.messageCount = GetUInt32(p + 24);
+		const uint32_t entryTypeCount = GetUInt32(p + 28);
+		p += 32;
+		if (static_cast<size_t>(end - p) / 8 < entryTypeCount) {
+			return false;
+		}
+		entry.typeCounts.resize(entryTypeCount);
+		for (uint32_t j = 0; j < entryTypeCount; ++j) {
+			entry.typeCounts[j].first = GetUInt32(p);
+			entry.typeCounts[j].second = GetUInt32(p + 4);
+			if (entry.typeCounts[j].first >= typeCount) {
+				return false;
+			}
+			p += 8;
+		}
+		AddEntry(entry);
+	}
+
+	m_currentCounts.resize(m_types.size());
+	return true;
+}
+
+bool RecordingIndex::Load(const char* data, size_t size)
+{
+	Clear();
+
+	if (size < fileHeaderSize + trailerSize) {
+		return false;
+	}
+
+	BlockHeader header;
+	const char* trailer = data + size - trailerSize;
+	if (!header.Decode(trailer) || header.blockType != TrailerBlock || header.storedSize != 8) {
+		return false; // not closed properly
+	}
+	const uint64_t indexOffset = GetUInt64(trailer + blockHeaderSize);
+	if (indexOffset < fileHeaderSize || indexOffset > size - trailerSize - blockHeaderSize) {
+		return false;
+	}
+
+	const char* index = data + indexOffset;
+	if (!header.Decode(index) || header.blockType != IndexBlock || header.compression != NoCompression
+		|| header.storedSize != static_cast<uint64_t>(trailer - index) - blockHeaderSize) {
+		return false;
+	}
+	return Decode(index + blockHeaderSize, static_cast<size_t>(header.storedSize));
+}
+
+bool RecordingIndex::Load(std::istream& input)
+{
+	Clear();
+
+	const std::istream::pos_type originalPosition = input.tellg();
+	if (originalPosition == std::istream::pos_type(-1)) {
+		return false; // not seekable
+	}
+
+	bool ok = false;
+	input.seekg(0, std::ios::end);
+	const std::istream::pos_type endPosition = input.tellg();
+	const uint64_t size = endPosition == std::istream::pos_type(-1) ? 0 : static_cast<uint64_t>(endPosition);
+
+	char trailer[trailerSize];
+	BlockHeader header;
+	if (size >= fileHeaderSize + trailerSize
+		&& input.seekg(static_cast<std::streamoff>(size - trailerSize)) && input.read(trailer, trailerSize)
+		&& header.Decode(trailer) && header.blockType == TrailerBlock && header.storedSize == 8) {
+
+		const uint64_t indexOffset = GetUInt64(trailer + blockHeaderSize);
+		char buffer[blockHeaderSize];
+		if (indexOffset >= fileHeaderSize && indexOffset <= size - trailerSize - blockHeaderSize
+			&& input.seekg(static_cast<std::streamoff>(indexOffset)) && input.read(buffer, blockHeaderSize)
+			&& header.Decode(buffer) && header.blockType == IndexBlock && header.compression == NoCompression
+			&& header.storedSize == size - trailerSize - indexOffset - blockHeaderSize) {
+
+			std::string payload(static_cast<size_t>(header.storedSize), '\0');
+			if (payload.empty() || input.read(&payload[0], payload.size())) {
+				ok = Decode(payload.data(), payload.size());
+			}
+		}
+	}
+
+	input.clear();
+	input.seekg(originalPosition);
+
+	if (!ok) {
+		Clear();
+	}
+	return ok;
+}
+
+bool RecordingIndex::AddBlock(uint64_t offset, const BlockHeader& header, const char* payload)
+{
+	const char* record = payload;
+	const char* blockEnd = payload + header.rawSize;
+	std::string type;
+
+	while (record != blockEnd) {
+		uint64_t timestamp = 0;
+		const char* typeData = NULL;
+		const char* text = NULL;
+		size_t typeLength = 0, textLength = 0;
+		if (!DecodeRecord(record, blockEnd, timestamp, typeData, typeLength, text, textLength)) {
+			std::fill(m_currentCounts.begin(), m_currentCounts.end(), 0);
+			return false; // corrupt
+		}
+		type.assign(typeData, typeLength);
+		AddMessage(type);
+	}
+	FinishBlock(offset, header);
+	return true;
+}
+
+bool RecordingIndex::Build(const char* data, size_t size)
+{
+	Clear();
+
+	if (size < fileHeaderSize) {
+		return false;
+	}
+
+	const char* p = data + fileHeaderSize;
+	const char* end = data + size;
+	std::string decompressed;
+
+	while (p != end) {
+		BlockHeader header;
+		if (static_cast<size_t>(end - p) < blockHeaderSize || !header.Decode(p)) {
+			return false; // truncated or corrupt
+		}
+		const char* payload = p + blockHeaderSize;
+		if (header.storedSize > static_cast<uint64_t>(end - payload)) {
+			return false; // truncated
+		}
+
+		if (header.blockType == MessageBlock) {
+			const char* rawPayload = payload;
+			if (header.compression != NoCompression) {
+				try {
+					DecompressPayload(header, payload, decompressed);
+				}
+				catch (std::exception&) {
+					return false;
+				}
+				rawPayload = decompressed.data();
+			}
+			else if (header.rawSize != header.storedSize) {
+				return false; // corrupt
+			}
+			if (!AddBlock(p - data, header, rawPayload)) {
+				return false;
+			}
+		}
+
+		p = payload + header.storedSize;
+	}
+
+	return true;
+}
+
+size_t RecordingIndex::FindBlock(uint64_t timestamp) const
+{
+	std::vector<Entry>::const_iterator i = std::lower_bound(m_entries.begin(), m_entries.end(), timestamp,
+		[](const Entry& entry, uint64_t timestamp) { return entry.maxLastTimestamp < timestamp; });
+	return i - m_entries.begin();
+}
+
+std::map<std::string, uint64_t> RecordingIndex::CountMessagesByType(uint64_t from, uint64_t to) const
+{
+	std::map<std::string, uint64_t> counts;
+	for (size_t i = FindBlock(from), end = m_entries.size(); i < end; ++i) {
+		const Entry& entry = m_entries[i];
+		if (entry.firstTimestamp > to || entry.lastTimestamp < from) {
+			continue; // the timestamps need not be strictly monotonic, so keep going
+		}
+		for (size_t j = 0, typeCount = entry.typeCounts.size(); j < typeCount; ++j) {
+			counts[m_types[entry.typeCounts[j].first]] += entry.typeCounts[j].second;
+		}
+	}
+	return counts;
+}
+
+void RecordingIndex::Clear()
+{
+	m_types.clear();
+	m_typeIds.clear();
+	m_entries.clear();
+	m_currentCounts.clear();
+}
+
+}
@@ -0,0 +1,88 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef CLAIM_RECORDING_INDEX_H
+#define CLAIM_RECORDING_INDEX_H
+
+#include "MessageRecording.h"
+
+#include <map>
+#include <unordered_map>
+
+namespace claim {
+
+//! A sparse index of a recording: one entry per message block.
+/*! The writer appends the index to the end of the recording when it is closed, as an
+	index block followed by a small, fixed-size trailer block that points to it.
+	Sequential readers simply skip both. If a recording was not closed properly (say,
+	the recorder crashed), the index can still be rebuilt by walking the blocks.
+*/
+class RecordingIndex {
+public:
+	struct Entry {
+		uint64_t offset = 0; // of the block header, from the beginning of the file
+		uint64_t firstTimestamp = 0;
+		uint64_t lastTimestamp = 0;
+		uint32_t messageCount = 0;
+		std::vector<std::pair<uint32_t, uint32_t>> typeCounts; // type id, message count
+
+		// the largest lastTimestamp so far; makes the binary search robust against clock adjustments
+		uint64_t maxLastTimestamp = 0;
+	};
+
+	// writing
+	void AddMessage(const std::string& type);
+	void FinishBlock(uint64_t offset, const RecordingFormat::BlockHeader& header);
+
+	//! Like AddMessage for each record of the (uncompressed) payload, followed by FinishBlock.
+	//! Returns false if the payload is corrupt.
+	bool AddBlock(uint64_t offset, const RecordingFormat::BlockHeader& header, const char* payload);
+
+	//! Encodes the index block and the trailer, to be written at indexOffset.
+	void EncodeFooter(uint64_t indexOffset, std::string& output) const;
+
+	// reading
+	//! Reads the index from the footer of the recording. Returns false if there is none.
+	bool Load(const char* data, size_t size);
+	bool Load(std::istream& input);
+
+	//! Rebuilds the index by walking through all the blocks.
+	/*! Returns false if some data is corrupt or truncated; the blocks before that are indexed nevertheless.
+	*/
+	bool Build(const char* data, size_t size);
+
+	const std::vector<Entry>& GetEntries() const { return m_entries; }
+	const std::vector<std::string>& GetTypes() const { return m_types; }
+
+	//! Returns the index of the first block that may contain messages at or after the timestamp,
+	//! or the number of entries if there are none.
+	size_t FindBlock(uint64_t timestamp) const;
+
+	//! Counts the messages by type in the blocks that overlap the time range [from, to].
+	/*! The resolution is one block: the blocks at the boundaries are counted as a whole.
+		The writers close a block at least every second, though.
+	*/
+	std::map<std::string, uint64_t> CountMessagesByType(uint64_t from, uint64_t to) const;
+
+	size_t GetFooterSize() const;
+
+	void Clear();
+
+private:
+	void AddEntry(Entry& entry);
+	bool Decode(const char* payload, size_t size);
+
+	std::vector<std::string> m_types;
+	std::unordered_map<std::string, uint32_t> m_typeIds;
+	std::vector<Entry> m_entries;
+
+	std::vector<uint32_t> m_currentCounts; // by type id, for the block being written
+};
+
+}
+
+#endif // CLAIM_RECORDING_INDEX_H
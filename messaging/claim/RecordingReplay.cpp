@@ -0,0 +1,134 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef WIN32
+#pragma warning (disable: 4786)
+#endif // WIN32
+
+#include "RecordingReplay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+namespace claim {
+
+namespace {
+	const std::chrono::milliseconds maxSleep(100); // how quickly Stop() takes effect
+}
+
+RecordingReplayer::RecordingReplayer()
+	: m_speed(1.0)
+	, m_from(0)
+	, m_to((std::numeric_limits<uint64_t>::max)())
+	, m_batchSize(1000)
+	, m_stop(false)
+{}
+
+void RecordingReplayer::SendAll(slaim::PostOffice& postOffice, std::vector<slaim::Message>& batch, Statistics& statistics)
+{
+	size_t sent = 0;
+	while (sent < batch.size() && !m_stop) {
+		sent += postOffice.SendBatch(batch, sent);
+		if (sent < batch.size()) {
+			++statistics.sendBufferFullCount;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1)); // let the sender catch up
+		}
+	}
+	for (size_t i = 0; i < sent; ++i) {
+		statistics.byteCount += batch[i].GetSize();
+	}
+	statistics.messageCount += sent;
+	batch.clear();
+}
+
+RecordingReplayer::Statistics RecordingReplayer::Replay(MappedRecordingReader& reader, slaim::PostOffice& postOffice)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	m_stop = false;
+	Statistics statistics;
+
+	if (reader.IsLegacyFormat() && (m_from > 0 || m_to != (std::numeric_limits<uint64_t>::max)())) {
+		throw std::runtime_error("Legacy recordings have no timestamps, so replaying a time range is not supported");
+	}
+
+	if (m_from > 0) {
+		if (!reader.SeekToTime(m_from)) {
+			return statistics;
+		}
+	}
+	else {
+		reader.Rewind();
+	}
+
+	const bool timed = m_speed > 0;
+	const Clock::time_point start = Clock::now();
+	Clock::time_point nextProgress = start + std::chrono::seconds(1);
+	bool haveOrigin = false;
+	uint64_t origin = 0;
+
+	std::vector<slaim::Message> batch;
+	batch.reserve(m_batchSize);
+
+	auto reportProgress = [&](Clock::time_point now) {
+		if (m_progressCallback && now >= nextProgress) {
+			statistics.seconds = std::chrono::duration<double>(now - start).count();
+			m_progressCallback(statistics);
+			nextProgress = now + std::chrono::seconds(1);
+		}
+	};
+
+	RecordedMessageView view;
+	while (!m_stop && reader.Next(view)) {
+		if (view.timestamp > m_to) {
+			break;
+		}
+		if (!m_types.empty() && m_types.find(view.type) == m_types.end()) {
+			++statistics.filteredCount;
+			continue;
+		}
+
+		if (timed) {
+			if (!haveOrigin) {
+				origin = view.timestamp;
+				haveOrigin = true;
+			}
+			const double offsetSeconds = view.timestamp > origin ? (view.timestamp - origin) * 1e-9 / m_speed : 0.0;
+			const Clock::time_point due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(offsetSeconds));
+
+			Clock::time_point now = Clock::now();
+			if (due > now) {
+				SendAll(postOffice, batch, statistics); // do not hold back what is already due
+				while (!m_stop && (now = Clock::now()) < due) {
+					reportProgress(now);
+					std::this_thread::sleep_until((std::min)(due, now + maxSleep));
+				}
+			}
+			else {
+				statistics.maxLagSeconds = (std::max)(statistics.maxLagSeconds, std::chrono::duration<double>(now - due).count());
+			}
+		}
+
+		batch.emplace_back();
+		view.ToMessage(batch.back());
+
+		if (batch.size() >= m_batchSize) {
+			SendAll(postOffice, batch, statistics);
+			reportProgress(Clock::now());
+		}
+	}
+
+	SendAll(postOffice, batch, statistics);
+
+	statistics.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	return statistics;
+}
+
+}
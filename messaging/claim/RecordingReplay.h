@@ -0,0 +1,83 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef CLAIM_RECORDING_REPLAY_H
+#define CLAIM_RECORDING_REPLAY_H
+
+#include "MappedRecording.h"
+
+#include <messaging/slaim/postoffice.h>
+
+#include <atomic>
+#include <functional>
+#include <set>
+
+namespace claim {
+
+//! Republishes a recording through a post office.
+/*! The messages are sent either with their original inter-arrival times (optionally sped up),
+	or as fast as the post office accepts them. The send times are computed from the start of
+	the replay rather than from the previous message, so sleeping inaccuracies do not accumulate;
+	if the replay falls behind, the overdue messages are sent in batches until it catches up.
+*/
+class RecordingReplayer {
+public:
+	RecordingReplayer();
+
+	//! 1 = original timing, 2 = twice as fast, etc. Zero means as fast as possible.
+	void SetSpeed(double speed) { m_speed = speed; }
+
+	//! Replays only messages of these types. Empty (the default) means all types.
+	void SetTypeFilter(const std::set<std::string, std::less<>>& types) { m_types = types; }
+
+	//! Replays only the messages recorded within [from, to] (nanoseconds since 1970-01-01 UTC).
+	void SetTimeRange(uint64_t from, uint64_t to) { m_from = from; m_to = to; }
+
+	//! The maximum number of messages passed to slaim::PostOffice::SendBatch at once.
+	void SetBatchSize(size_t batchSize) { m_batchSize = batchSize > 0 ? batchSize : 1; }
+
+	struct Statistics {
+		uint64_t messageCount = 0;
+		uint64_t byteCount = 0;
+		uint64_t filteredCount = 0;    // skipped because of the type filter
+		uint64_t sendBufferFullCount = 0; // how many times we had to wait for the post office
+		double seconds = 0;
+		double maxLagSeconds = 0;      // the worst delay compared to the schedule (timed replay only)
+
+		double GetMessagesPerSecond() const { return seconds > 0 ? messageCount / seconds : 0; }
+	};
+
+	//! Called every now and then (roughly once a second) during the replay.
+	void SetProgressCallback(const std::function<void(const Statistics&)>& callback) { m_progressCallback = callback; }
+
+	//! Blocks until the recording (or the time range) has been replayed, or Stop() is called.
+	//! Throws std::runtime_error if a time range has been set, but the recording is in the
+	//! legacy format, which has no timestamps.
+	Statistics Replay(MappedRecordingReader& reader, slaim::PostOffice& postOffice);
+
+	//! May be called from any thread.
+	void Stop() { m_stop = true; }
+
+private:
+	// make the class non-copyable
+	RecordingReplayer(const RecordingReplayer&);
+	RecordingReplayer& operator= (const RecordingReplayer&);
+
+	void SendAll(slaim::PostOffice& postOffice, std::vector<slaim::Message>& batch, Statistics& statistics);
+
+	double m_speed;
+	std::set<std::string, std::less<>> m_types;
+	uint64_t m_from;
+	uint64_t m_to;
+	size_t m_batchSize;
+	std::function<void(const Statistics&)> m_progressCallback;
+	std::atomic<bool> m_stop;
+};
+
+}
+
+#endif // CLAIM_RECORDING_REPLAY_H
@@ -0,0 +1,419 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef WIN32
+#pragma warning (disable: 4786)
+#endif // WIN32
+
+#include "RecordingScan.h"
+#include "AttributeMessage.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace claim {
+
+namespace {
+	const uint64_t wholeFile = (std::numeric_limits<uint64_t>::max)(); // a legacy recording has no blocks
+
+	// how many blocks per worker may be scanned ahead of the merge
+	const size_t blocksAheadPerWorker = 4;
+
+	struct WorkItem {
+		size_t file;
+		uint64_t offset; // of the block header
+		uint64_t firstTimestamp;
+	};
+
+	// the matching messages of a block, re-encoded as records
+	struct Result {
+		std::string records;
+	};
+
+	void AppendRecord(std::string& records, const RecordedMessageView& view)
+	{
+		const size_t offset = records.size();
+		records.resize(offset + RecordingFormat::recordHeaderSize);
+		char* p = &records[offset];
+		RecordingFormat::PutUInt64(p, view.timestamp);
+		RecordingFormat::PutUInt32(p + 8, static_cast<uint32_t>(view.type.length()));
+		RecordingFormat::PutUInt64(p + 12, static_cast<uint64_t>(view.text.length()));
+		records.append(view.type.data(), view.type.length());
+		records.append(view.text.data(), view.text.length());
+	}
+
+	// a position in the result of a block, for merging
+	struct Cursor {
+		size_t item = 0;
+		const char* position = NULL;
+		const char* end = NULL;
+		RecordedMessageView view;
+
+		bool Advance()
+		{
+			const char* type = NULL;
+			const char* text = NULL;
+			size_t typeLength = 0, textLength = 0;
+			if (position == end || !RecordingFormat::DecodeRecord(position, end, view.timestamp, type, typeLength, text, textLength)) {
+				return false;
+			}
+			view.type = std::string_view(type, typeLength);
+			view.text = std::string_view(text, textLength);
+			return true;
+		}
+	};
+
+	// for a min-heap; ties are broken by the order of the blocks
+	bool IsLater(const Cursor& a, const Cursor& b)
+	{
+		if (a.view.timestamp != b.view.timestamp) {
+			return a.view.timestamp > b.view.timestamp;
+		}
+		return a.item > b.item;
+	}
+}
+
+class RecordingScanner::Job {
+public:
+	Job(const RecordingScanner& scanner, const std::vector<std::unique_ptr<MappedRecordingReader>>& readers, const std::vector<WorkItem>& items);
+	~Job(); // stops
+
+	void Start(unsigned int threadCount);
+	void Stop();
+
+	//! Blocks until the item has been scanned; lets the workers proceed to the items after it.
+	const Result& WaitForResult(size_t item);
+	void Release(size_t item);
+
+	Statistics GetStatistics();
+
+private:
+	void RunWorker();
+	void Process(const WorkItem& item, std::string& buffer, Result& result, Statistics& statistics) const;
+
+	const RecordingScanner& scanner;
+	const std::vector<std::unique_ptr<MappedRecordingReader>>& readers;
+	const std::vector<WorkItem>& items;
+
+	std::vector<std::thread> workers;
+	size_t maxItemsAhead = 0;
+
+	std::mutex mutex;
+	std::condition_variable resultReady;
+	std::condition_variable windowOpen;
+	size_t nextItem = 0;       // to be scanned
+	size_t consumedItems = 0;  // taken by the merge
+	std::vector<std::unique_ptr<Result>> results;
+	bool killed = false;
+	std::exception_ptr exception;
+	Statistics statistics;
+};
+
+RecordingScanner::Job::Job(const RecordingScanner& scanner, const std::vector<std::unique_ptr<MappedRecordingReader>>& readers, const std::vector<WorkItem>& items)
+	: scanner(scanner)
+	, readers(readers)
+	, items(items)
+	, results(items.size())
+{}
+
+RecordingScanner::Job::~Job()
+{
+	Stop();
+}
+
+void RecordingScanner::Job::Start(unsigned int threadCount)
+{
+	maxItemsAhead = blocksAheadPerWorker * threadCount;
+	for (unsigned int i = 0; i < threadCount; ++i) {
+		workers.push_back(std::thread(&Job::RunWorker, this));
+	}
+}
+
+void RecordingScanner::Job::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		killed = true;
+	}
+	windowOpen.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+}
+
+void RecordingScanner::Job::RunWorker()
+{
+	std::string buffer; // for decompressing, reused
+
+	while (true) {
+		size_t i = 0;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			windowOpen.wait(lock, [this]() { return killed || nextItem >= items.size() || nextItem < consumedItems + maxItemsAhead; });
+			if (killed || nextItem >= items.size()) {
+				return;
+			}
+			i = nextItem++;
+		}
+
+		std::unique_ptr<Result> result(new Result);
+		Statistics itemStatistics;
+		try {
+			Process(items[i], buffer, *result, itemStatistics);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!exception) {
+				exception = std::current_exception();
+			}
+			killed = true;
+			resultReady.notify_all();
+			windowOpen.notify_all();
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		results[i] = std::move(result);
+		statistics.blockCount += itemStatistics.blockCount;
+		statistics.corruptBlockCount += itemStatistics.corruptBlockCount;
+		statistics.messageCount += itemStatistics.messageCount;
+		statistics.byteCount += itemStatistics.byteCount;
+		resultReady.notify_all();
+	}
+}
+
+void RecordingScanner::Job::Process(const WorkItem& item, std::string& buffer, Result& result, Statistics& itemStatistics) const
+{
+	MappedRecordingReader& reader = *readers[item.file];
+
+	if (item.offset == wholeFile) {
+		// this worker is the only one using the reader
+		RecordedMessageView view;
+		while (reader.Next(view)) {
+			++itemStatistics.messageCount;
+			itemStatistics.byteCount += view.type.length() + view.text.length();
+			if (scanner.Matches(view)) {
+				AppendRecord(result.records, view);
+			}
+		}
+		return;
+	}
+
+	++itemStatistics.blockCount;
+
+	RecordingFormat::BlockHeader header;
+	const char* data = reader.GetData();
+	const uint64_t size = reader.GetSize();
+	if (item.offset > size || size - item.offset < RecordingFormat::blockHeaderSize || !header.Decode(data + item.offset)
+		|| header.storedSize > size - item.offset - RecordingFormat::blockHeaderSize) {
+		++itemStatistics.corruptBlockCount;
+		return;
+	}
+
+	const char* position = data + item.offset + RecordingFormat::blockHeaderSize;
+	const char* end = position + header.storedSize;
+	if (header.compression != RecordingFormat::NoCompression) {
+		try {
+			RecordingFormat::DecompressPayload(header, position, buffer);
+		}
+		catch (std::runtime_error&) {
+			++itemStatistics.corruptBlockCount;
+			return;
+		}
+		position = buffer.data();
+		end = position + buffer.size();
+	}
+	itemStatistics.byteCount += end - position;
+
+	RecordedMessageView view;
+	while (position != end) {
+		const char* type = NULL;
+		const char* text = NULL;
+		size_t typeLength = 0, textLength = 0;
+		if (!RecordingFormat::DecodeRecord(position, end, view.timestamp, type, typeLength, text, textLength)) {
+			++itemStatistics.corruptBlockCount;
+			return; // keep what was found before
+		}
+		++itemStatistics.messageCount;
+		view.type = std::string_view(type, typeLength);
+		view.text = std::string_view(text, textLength);
+		if (scanner.Matches(view)) {
+			AppendRecord(result.records, view);
+		}
+	}
+}
+
+const Result& RecordingScanner::Job::WaitForResult(size_t item)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	resultReady.wait(lock, [&]() { return results[item] || exception; });
+	if (exception) {
+		std::rethrow_exception(exception);
+	}
+	consumedItems = item + 1;
+	windowOpen.notify_all();
+	return *results[item];
+}
+
+void RecordingScanner::Job::Release(size_t item)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	results[item].reset();
+}
+
+RecordingScanner::Statistics RecordingScanner::Job::GetStatistics()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return statistics;
+}
+
+RecordingScanner::RecordingScanner(unsigned int threadCount)
+	: m_threadCount(threadCount > 0 ? threadCount : (std::max)(1u, std::thread::hardware_concurrency()))
+	, m_from(0)
+	, m_to((std::numeric_limits<uint64_t>::max)())
+	, m_stop(false)
+{}
+
+void RecordingScanner::AddAttributeFilter(const std::string& name, const std::string& value)
+{
+	m_attributes.push_back(std::make_pair(name, value));
+}
+
+bool RecordingScanner::Matches(const RecordedMessageView& view) const
+{
+	if (view.timestamp < m_from || view.timestamp > m_to) {
+		return false;
+	}
+	if (!m_types.empty() && m_types.find(view.type) == m_types.end()) {
+		return false;
+	}
+	for (size_t i = 0; i < m_attributes.size(); ++i) {
+		std::string_view value;
+		if (!FindAttribute(view.text, m_attributes[i].first, value) || value != m_attributes[i].second) {
+			return false;
+		}
+	}
+	return !m_predicate || m_predicate(view);
+}
+
+bool RecordingScanner::MayMatch(const RecordingIndex& index, const RecordingIndex::Entry& entry) const
+{
+	if (entry.lastTimestamp < m_from || entry.firstTimestamp > m_to) {
+		return false;
+	}
+	if (m_types.empty()) {
+		return true;
+	}
+	const std::vector<std::string>& types = index.GetTypes();
+	for (size_t i = 0; i < entry.typeCounts.size(); ++i) {
+		const uint32_t typeId = entry.typeCounts[i].first;
+		if (typeId >= types.size() || m_types.find(types[typeId]) != m_types.end()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+RecordingScanner::Statistics RecordingScanner::Scan(const std::vector<std::string>& filenames, const Output& output)
+{
+	typedef std::chrono::steady_clock Clock;
+	const Clock::time_point start = Clock::now();
+
+	m_stop = false;
+
+	std::vector<std::unique_ptr<MappedRecordingReader>> readers;
+	std::vector<WorkItem> items;
+	uint64_t skippedBlockCount = 0;
+
+	for (size_t f = 0; f < filenames.size(); ++f) {
+		readers.emplace_back(new MappedRecordingReader(filenames[f]));
+		MappedRecordingReader& reader = *readers.back();
+		if (reader.IsLegacyFormat()) {
+			const WorkItem item = { f, wholeFile, 0 };
+			items.push_back(item);
+			continue;
+		}
+		const RecordingIndex& index = reader.GetIndex();
+		const std::vector<RecordingIndex::Entry>& entries = index.GetEntries();
+		for (size_t i = 0; i < entries.size(); ++i) {
+			if (MayMatch(index, entries[i])) {
+				const WorkItem item = { f, entries[i].offset, entries[i].firstTimestamp };
+				items.push_back(item);
+			}
+			else {
+				++skippedBlockCount;
+			}
+		}
+	}
+
+	// the merge below takes the blocks in this order
+	std::stable_sort(items.begin(), items.end(), [](const WorkItem& a, const WorkItem& b) {
+		return a.firstTimestamp < b.firstTimestamp;
+	});
+
+	Job job(*this, readers, items);
+	job.Start(m_threadCount);
+
+	uint64_t matchCount = 0;
+	std::vector<Cursor> heap;
+	size_t nextItem = 0;
+
+	while (!m_stop) {
+		// before passing on a message, make sure that no block yet to come can contain an earlier one
+		while (nextItem < items.size() && (heap.empty() || items[nextItem].firstTimestamp <= heap.front().view.timestamp)) {
+			const Result& result = job.WaitForResult(nextItem);
+			Cursor cursor;
+			cursor.item = nextItem;
+			cursor.position = result.records.data();
+			cursor.end = cursor.position + result.records.size();
+			if (cursor.Advance()) {
+				heap.push_back(cursor);
+				std::push_heap(heap.begin(), heap.end(), IsLater);
+			}
+			else {
+				job.Release(nextItem);
+			}
+			++nextItem;
+		}
+
+		if (heap.empty()) {
+			break;
+		}
+
+		std::pop_heap(heap.begin(), heap.end(), IsLater);
+		Cursor& cursor = heap.back();
+		output(cursor.view);
+		++matchCount;
+
+		if (cursor.Advance()) {
+			std::push_heap(heap.begin(), heap.end(), IsLater);
+		}
+		else {
+			job.Release(cursor.item);
+			heap.pop_back();
+		}
+	}
+
+	job.Stop();
+
+	Statistics statistics = job.GetStatistics();
+	statistics.fileCount = filenames.size();
+	statistics.skippedBlockCount = skippedBlockCount;
+	statistics.matchCount = matchCount;
+	statistics.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	return statistics;
+}
+
+}
@@ -0,0 +1,110 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef CLAIM_RECORDING_SCAN_H
+#define CLAIM_RECORDING_SCAN_H
+
+#include "MappedRecording.h"
+
+#include <atomic>
+#include <functional>
+#include <set>
+
+namespace claim {
+
+//! Searches recordings for matching messages using all the cores.
+/*! The recordings are split at their block boundaries, and the blocks are filtered
+	in parallel by a pool of worker threads. The time index is used to skip the blocks
+	that cannot contain any messages of the requested types or time range, without even
+	reading them. The calling thread merges the results in timestamp order:
+	<pre>
+	claim::RecordingScanner scanner;
+	scanner.SetTypeFilter({ "__claim_MsgStatus" });
+	scanner.AddAttributeFilter("host", "server-1");
+	scanner.Scan(filenames, [&](const claim::RecordedMessageView& view) {
+		writer.Write(view.ToMessage(), view.timestamp);
+	});
+	</pre>
+	The records within each block are assumed to be in timestamp order (as they are,
+	unless the clock was adjusted backwards while recording).
+*/
+class RecordingScanner {
+public:
+	/*! \param threadCount The number of worker threads. If zero, the number of hardware
+	           threads is used. The calling thread does the merging.
+	*/
+	explicit RecordingScanner(unsigned int threadCount = 0);
+
+	//! Scans only messages of these types. Empty (the default) means all types.
+	void SetTypeFilter(const std::set<std::string, std::less<>>& types) { m_types = types; }
+
+	//! Scans only the messages recorded within [from, to] (nanoseconds since 1970-01-01 UTC).
+	void SetTimeRange(uint64_t from, uint64_t to) { m_from = from; m_to = to; }
+
+	//! Scans only messages having the attribute (see AttributeMessage) with the given value.
+	//! If called several times, all the attributes have to match.
+	void AddAttributeFilter(const std::string& name, const std::string& value);
+
+	typedef std::function<bool(const RecordedMessageView&)> Predicate;
+
+	//! An arbitrary condition, checked after the filters above.
+	/*! Called concurrently from the worker threads, so it needs to be thread-safe.
+	*/
+	void SetPredicate(const Predicate& predicate) { m_predicate = predicate; }
+
+	struct Statistics {
+		uint64_t fileCount = 0;
+		uint64_t blockCount = 0;         // scanned
+		uint64_t skippedBlockCount = 0;  // ruled out using the time index
+		uint64_t corruptBlockCount = 0;  // could not be decompressed or parsed (fully)
+		uint64_t messageCount = 0;       // scanned
+		uint64_t matchCount = 0;
+		uint64_t byteCount = 0;          // scanned, after decompression
+		double seconds = 0;
+
+		double GetMessagesPerSecond() const { return seconds > 0 ? messageCount / seconds : 0; }
+		double GetBytesPerSecond() const { return seconds > 0 ? byteCount / seconds : 0; }
+	};
+
+	typedef std::function<void(const RecordedMessageView&)> Output;
+
+	//! Scans the recordings, and passes the matching messages to output in timestamp order.
+	/*! The files may be separate recordings, or the segments of one (see ListRecordingSegments);
+		either way, the messages are merged. The output is called on the calling thread, and
+		the view is valid only during the call.
+		Throws std::runtime_error if a file cannot be opened; exceptions thrown by the
+		output or the predicate are passed through, after stopping the workers.
+	*/
+	Statistics Scan(const std::vector<std::string>& filenames, const Output& output);
+
+	//! May be called from any thread (for example, from the output).
+	void Stop() { m_stop = true; }
+
+	unsigned int GetThreadCount() const { return m_threadCount; }
+
+private:
+	// make the class non-copyable
+	RecordingScanner(const RecordingScanner&);
+	RecordingScanner& operator= (const RecordingScanner&);
+
+	class Job;
+
+	bool Matches(const RecordedMessageView& view) const;
+	bool MayMatch(const RecordingIndex& index, const RecordingIndex::Entry& entry) const;
+
+	unsigned int m_threadCount;
+	std::set<std::string, std::less<>> m_types;
+	uint64_t m_from;
+	uint64_t m_to;
+	std::vector<std::pair<std::string, std::string>> m_attributes;
+	Predicate m_predicate;
+	std::atomic<bool> m_stop;
+};
+
+}
+
+#endif // CLAIM_RECORDING_SCAN_H
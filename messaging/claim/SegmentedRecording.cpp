@@ -0,0 +1,237 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef WIN32
+#pragma warning (disable: 4786)
+#endif // WIN32
+
+#include "SegmentedRecording.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace claim {
+
+namespace {
+
+	const char* extension = ".nmr";
+	const uint64_t nanosecondsPerSecond = 1000000000;
+
+	// see http://howardhinnant.github.io/date_algorithms.html
+	int64_t DaysFromCivil(int64_t y, unsigned m, unsigned d)
+	{
+		y -= m <= 2;
+		const int64_t era = (y >= 0 ? y : y - 399) / 400;
+		const unsigned yoe = static_cast<unsigned>(y - era * 400);
+		const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+		const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+		return era * 146097 + static_cast<int64_t>(doe) - 719468;
+	}
+
+	void CivilFromDays(int64_t z, int64_t& y, unsigned& m, unsigned& d)
+	{
+		z += 719468;
+		const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+		const unsigned doe = static_cast<unsigned>(z - era * 146097);
+		const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+		const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+		const unsigned mp = (5 * doy + 2) / 153;
+		d = doy - (153 * mp + 2) / 5 + 1;
+		m = mp < 10 ? mp + 3 : mp - 9;
+		y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+	}
+
+	std::string FormatTimestamp(uint64_t timestamp)
+	{
+		const uint64_t seconds = timestamp / nanosecondsPerSecond;
+		const uint64_t secondsOfDay = seconds % 86400;
+		int64_t year = 0;
+		unsigned month = 0, day = 0;
+		CivilFromDays(static_cast<int64_t>(seconds / 86400), year, month, day);
+
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), "%04d%02u%02uT%02u%02u%02u.%09uZ",
+			static_cast<int>(year), month, day,
+			static_cast<unsigned>(secondsOfDay / 3600), static_cast<unsigned>(secondsOfDay / 60 % 60), static_cast<unsigned>(secondsOfDay % 60),
+			static_cast<unsigned>(timestamp % nanosecondsPerSecond));
+		return buffer;
+	}
+
+	bool ParseTimestamp(const std::string& text, uint64_t& timestamp)
+	{
+		int year = 0;
+		unsigned month = 0, day = 0, hours = 0, minutes = 0, seconds = 0, nanoseconds = 0;
+		char z = 0;
+		if (text.length() != 26 || sscanf(text.c_str(), "%4d%2u%2uT%2u%2u%2u.%9u%c", &year, &month, &day, &hours, &minutes, &seconds, &nanoseconds, &z) != 8 || z != 'Z') {
+			return false;
+		}
+		const int64_t days = DaysFromCivil(year, month, day);
+		if (days < 0) {
+			return false;
+		}
+		timestamp = (static_cast<uint64_t>(days) * 86400 + hours * 3600 + minutes * 60 + seconds) * nanosecondsPerSecond + nanoseconds;
+		return true;
+	}
+}
+
+std::string GetRecordingSegmentFilename(const RecordingSegmentSettings& settings, uint64_t startTimestamp)
+{
+	return (std::filesystem::path(settings.directory) / (settings.prefix + "-" + FormatTimestamp(startTimestamp) + extension)).string();
+}
+
+std::vector<RecordingSegment> ListRecordingSegments(const std::string& directory, const std::string& prefix)
+{
+	std::vector<RecordingSegment> segments;
+
+	std::error_code error;
+	for (std::filesystem::directory_iterator i(directory, error), end; !error && i != end; i.increment(error)) {
+		const std::string name = i->path().filename().string();
+		const std::string namePrefix = prefix + "-";
+		if (name.length() <= namePrefix.length() + strlen(extension)
+			|| name.compare(0, namePrefix.length(), namePrefix) != 0
+			|| name.compare(name.length() - strlen(extension), std::string::npos, extension) != 0) {
+			continue;
+		}
+
+		RecordingSegment segment;
+		if (!ParseTimestamp(name.substr(namePrefix.length(), name.length() - namePrefix.length() - strlen(extension)), segment.startTimestamp)) {
+			continue;
+		}
+		std::error_code sizeError;
+		segment.size = std::filesystem::file_size(i->path(), sizeError);
+		if (sizeError) {
+			continue; // deleted meanwhile, perhaps
+		}
+		segment.filename = i->path().string();
+		segments.push_back(segment);
+	}
+
+	std::sort(segments.begin(), segments.end(), [](const RecordingSegment& a, const RecordingSegment& b) {
+		return a.startTimestamp < b.startTimestamp;
+	});
+	return segments;
+}
+
+size_t ApplyRecordingRetention(const RecordingSegmentSettings& settings, const std::string& activeFilename, std::string* errors)
+{
+	if (settings.maxTotalBytes == 0 && settings.maxAgeSeconds <= 0) {
+		return 0;
+	}
+
+	const std::vector<RecordingSegment> segments = ListRecordingSegments(settings.directory, settings.prefix);
+
+	uint64_t totalBytes = 0;
+	for (size_t i = 0; i < segments.size(); ++i) {
+		totalBytes += segments[i].size;
+	}
+
+	const uint64_t now = GetRecordingTimestampNow();
+	const uint64_t maxAge = static_cast<uint64_t>(settings.maxAgeSeconds * nanosecondsPerSecond);
+
+	size_t deleted = 0;
+	for (size_t i = 0; i + 1 < segments.size(); ++i) { // the newest one is never deleted
+		const RecordingSegment& segment = segments[i];
+		if (segment.filename == activeFilename) {
+			break;
+		}
+
+		// the segment ends where the next one starts
+		const uint64_t endTimestamp = segments[i + 1].startTimestamp;
+		const bool tooOld = maxAge > 0 && endTimestamp < now && now - endTimestamp > maxAge;
+		const bool tooMuch = settings.maxTotalBytes > 0 && totalBytes > settings.maxTotalBytes;
+		if (!tooOld && !tooMuch) {
+			break;
+		}
+
+		std::error_code error;
+		if (std::filesystem::remove(segment.filename, error)) {
+			totalBytes -= segment.size;
+			++deleted;
+		}
+		else if (error && errors) {
+			*errors += "Unable to delete " + segment.filename + ": " + error.message() + "\n";
+		}
+	}
+	return deleted;
+}
+
+SegmentedRecordingReader::SegmentedRecordingReader(const std::string& directory, const std::string& prefix)
+	: m_directory(directory)
+	, m_prefix(prefix)
+	, m_current(0)
+{
+	Rewind();
+}
+
+SegmentedRecordingReader::~SegmentedRecordingReader()
+{}
+
+void SegmentedRecordingReader::Rewind()
+{
+	m_segments = ListRecordingSegments(m_directory, m_prefix);
+	m_reader.reset();
+	OpenSegment(0);
+}
+
+bool SegmentedRecordingReader::OpenSegment(size_t index)
+{
+	m_reader.reset();
+	for (m_current = index; m_current < m_segments.size(); ++m_current) {
+		try {
+			m_reader.reset(new MappedRecordingReader(m_segments[m_current].filename));
+			return true;
+		}
+		catch (std::exception&) {
+			// deleted by the retention, perhaps; skip it
+		}
+	}
+	return false;
+}
+
+bool SegmentedRecordingReader::Next(RecordedMessageView& view)
+{
+	while (m_reader) {
+		if (m_reader->Next(view)) {
+			return true;
+		}
+		OpenSegment(m_current + 1);
+	}
+	return false;
+}
+
+bool SegmentedRecordingReader::Read(slaim::Message& msg, uint64_t* timestamp)
+{
+	RecordedMessageView view;
+	if (!Next(view)) {
+		return false;
+	}
+	view.ToMessage(msg);
+	if (timestamp) {
+		*timestamp = view.timestamp;
+	}
+	return true;
+}
+
+bool SegmentedRecordingReader::SeekToTime(uint64_t timestamp)
+{
+	// the last segment that starts at or before the timestamp
+	std::vector<RecordingSegment>::const_iterator i = std::upper_bound(m_segments.begin(), m_segments.end(), timestamp,
+		[](uint64_t timestamp, const RecordingSegment& segment) { return timestamp < segment.startTimestamp; });
+	size_t index = i == m_segments.begin() ? 0 : (i - m_segments.begin()) - 1;
+
+	while (OpenSegment(index)) {
+		if (m_reader->SeekToTime(timestamp)) {
+			return true;
+		}
+		index = m_current + 1; // the rest of the segment is older; any later segment starts later
+	}
+	return false;
+}
+
+}
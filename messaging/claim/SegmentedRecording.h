@@ -0,0 +1,94 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef CLAIM_SEGMENTED_RECORDING_H
+#define CLAIM_SEGMENTED_RECORDING_H
+
+#include "MappedRecording.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace claim {
+
+//! How a recording is split into segment files, and how long the segments are kept.
+/*! The segments are named <prefix>-<start time>.nmr, e.g. recording-20260301T140310.000000000Z.nmr,
+	where the start time (UTC) is the timestamp of the first message in the segment.
+	So sorting the names also sorts the segments in time.
+*/
+struct RecordingSegmentSettings {
+	std::string directory = ".";
+	std::string prefix = "recording";
+
+	// a new segment is started when either limit would be exceeded (zero = no limit)
+	uint64_t maxSegmentBytes = 256 * 1024 * 1024;
+	double maxSegmentSeconds = 3600;
+
+	// the oldest segments are deleted when either limit is exceeded (zero = no limit)
+	uint64_t maxTotalBytes = 0;
+	double maxAgeSeconds = 0;
+};
+
+struct RecordingSegment {
+	std::string filename; // including the directory
+	uint64_t startTimestamp = 0;
+	uint64_t size = 0;
+};
+
+std::string GetRecordingSegmentFilename(const RecordingSegmentSettings& settings, uint64_t startTimestamp);
+
+//! Returns the segments in the directory, oldest first. Other files are ignored.
+std::vector<RecordingSegment> ListRecordingSegments(const std::string& directory, const std::string& prefix);
+
+//! Deletes the oldest segments that exceed the retention limits; never the one named activeFilename.
+/*! Returns the number of segments deleted; errors are appended to errors, if non-NULL.
+*/
+size_t ApplyRecordingRetention(const RecordingSegmentSettings& settings, const std::string& activeFilename, std::string* errors = NULL);
+
+//! Reads a directory of recording segments as if it were one continuous recording.
+/*! The segments are listed when the reader is constructed (and when Rewind() is called).
+	Only one segment at a time is mapped to memory, so a view returned by Next() remains
+	valid only until the next call of Next(), Read(), SeekToTime() or Rewind().
+*/
+class SegmentedRecordingReader {
+public:
+	SegmentedRecordingReader(const std::string& directory, const std::string& prefix = "recording");
+	~SegmentedRecordingReader();
+
+	//! Returns false at the end of the last segment.
+	bool Next(RecordedMessageView& view);
+	bool Read(slaim::Message& msg, uint64_t* timestamp = NULL);
+
+	//! Positions the reader at the first message whose timestamp is at or after the given one.
+	/*! Picks the segment by its name, and then binary-searches its time index.
+		Returns false if there is no such message.
+	*/
+	bool SeekToTime(uint64_t timestamp);
+
+	//! Lists the segments again, and starts reading from the beginning of the first one.
+	void Rewind();
+
+	const std::vector<RecordingSegment>& GetSegments() const { return m_segments; }
+
+private:
+	// make the class non-copyable
+	SegmentedRecordingReader(const SegmentedRecordingReader&);
+	SegmentedRecordingReader& operator= (const SegmentedRecordingReader&);
+
+	bool OpenSegment(size_t index); // returns false if there are no more segments
+
+	const std::string m_directory;
+	const std::string m_prefix;
+	std::vector<RecordingSegment> m_segments;
+	size_t m_current;
+	std::unique_ptr<MappedRecordingReader> m_reader;
+};
+
+}
+
+#endif // CLAIM_SEGMENTED_RECORDING_H
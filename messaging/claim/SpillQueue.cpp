@@ -0,0 +1,341 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef WIN32
+#pragma warning (disable: 4786)
+#endif // WIN32
+
+#include "SpillQueue.h"
+#include "MessageRecording.h"
+
+#include <messaging/slaim/errorlog.h>
+
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+namespace claim {
+
+class SpillQueue::Impl {
+public:
+	Impl(const RecordingSegmentSettings& settings, size_t blockSize);
+
+	void OpenWriteSegment();
+	void CloseWriteSegment();
+	bool OpenReadSegment(); // the oldest closed one
+	bool OpenWriteSegmentForReading(); // when there are no closed ones left
+	void DeleteReadSegment();
+	void DeleteWriteSegment(); // once it has been read through
+
+	uint64_t GetByteCount();
+
+	const RecordingSegmentSettings settings;
+	const size_t blockSize;
+
+	std::deque<RecordingSegment> closedSegments; // oldest first, including the one being read
+	uint64_t closedSegmentBytes;
+
+	RecordingSegment writeSegment;
+	uint64_t writeSegmentBytes; // including what has not been written to the file yet
+	uint64_t writeSegmentMessageCount;
+	std::ofstream writeFile;
+	std::unique_ptr<MessageRecordingWriter> writer;
+
+	std::ifstream readFile;
+	std::unique_ptr<MessageRecordingReader> reader;
+	bool readingWriteSegment; // rather than closedSegments.front()
+	uint64_t writeSegmentReadCount;
+
+	uint64_t pushedMessageCount;
+	uint64_t poppedMessageCount;
+
+	slaim::ErrorLog errorLog;
+};
+
+SpillQueue::Impl::Impl(const RecordingSegmentSettings& settings, size_t blockSize)
+	: settings(settings)
+	, blockSize(blockSize)
+	, closedSegmentBytes(0)
+	, writeSegmentBytes(0)
+	, writeSegmentMessageCount(0)
+	, readingWriteSegment(false)
+	, writeSegmentReadCount(0)
+	, pushedMessageCount(0)
+	, poppedMessageCount(0)
+{
+	std::error_code error;
+	std::filesystem::create_directories(settings.directory, error);
+	if (error) {
+		throw std::runtime_error("Unable to create " + settings.directory + ": " + error.message());
+	}
+
+	// left over by a previous run
+	const std::vector<RecordingSegment> segments = ListRecordingSegments(settings.directory, settings.prefix);
+	for (size_t i = 0; i < segments.size(); ++i) {
+		closedSegments.push_back(segments[i]);
+		closedSegmentBytes += segments[i].size;
+	}
+}
+
+void SpillQueue::Impl::OpenWriteSegment()
+{
+	uint64_t startTimestamp = GetRecordingTimestampNow();
+	std::string filename = GetRecordingSegmentFilename(settings, startTimestamp);
+	std::error_code error;
+	while (std::filesystem::exists(filename, error)) {
+		filename = GetRecordingSegmentFilename(settings, ++startTimestamp); // never overwrite
+	}
+
+	writeFile.open(filename.c_str(), std::ios::binary | std::ios::trunc);
+	if (!writeFile) {
+		writeFile.clear();
+		throw std::runtime_error("Unable to create " + filename);
+	}
+	writer.reset(new MessageRecordingWriter(writeFile, blockSize));
+	writeSegment.filename = filename;
+	writeSegment.startTimestamp = startTimestamp;
+	writeSegmentBytes = RecordingFormat::fileHeaderSize;
+	writeSegmentMessageCount = 0;
+}
+
+void SpillQueue::Impl::CloseWriteSegment()
+{
+	writer->Close();
+	writer.reset();
+	writeFile.close();
+	if (writeFile.fail()) {
+		errorLog.SetError("Error writing " + writeSegment.filename);
+	}
+	writeFile.clear();
+
+	std::error_code error;
+	writeSegment.size = std::filesystem::file_size(writeSegment.filename, error);
+	closedSegments.push_back(writeSegment);
+	closedSegmentBytes += writeSegment.size;
+
+	if (readingWriteSegment) {
+		readingWriteSegment = false; // read on as a closed segment, which it is the only one of
+		readFile.clear(); // may have hit the end of what was written so far
+	}
+}
+
+bool SpillQueue::Impl::OpenReadSegment()
+{
+	const std::string& filename = closedSegments.front().filename;
+	readFile.open(filename.c_str(), std::ios::binary);
+	if (!readFile) {
+		readFile.clear();
+		errorLog.SetError("Unable to open " + filename + " - skipping it");
+		closedSegmentBytes -= closedSegments.front().size;
+		closedSegments.pop_front();
+		return false;
+	}
+	try {
+		reader.reset(new MessageRecordingReader(readFile));
+	}
+	catch (std::exception& e) {
+		errorLog.SetError(filename + ": " + e.what() + " - skipping it");
+		readFile.close();
+		readFile.clear();
+		closedSegmentBytes -= closedSegments.front().size;
+		closedSegments.pop_front();
+		return false;
+	}
+	return true;
+}
+
+bool SpillQueue::Impl::OpenWriteSegmentForReading()
+{
+	// read it while it is still being written, rather than close it (and write its index) just
+	// to have it read, every time the reader catches up
+	writeFile.flush(); // the file header, and any whole blocks
+	readFile.open(writeSegment.filename.c_str(), std::ios::binary);
+	if (!readFile) {
+		readFile.clear();
+		errorLog.SetError("Unable to open " + writeSegment.filename + " for reading");
+		return false;
+	}
+	reader.reset(new MessageRecordingReader(readFile));
+	readingWriteSegment = true;
+	writeSegmentReadCount = 0;
+	return true;
+}
+
+void SpillQueue::Impl::DeleteReadSegment()
+{
+	reader.reset();
+	readFile.close();
+	readFile.clear();
+
+	const RecordingSegment& segment = closedSegments.front();
+	std::error_code error;
+	if (!std::filesystem::remove(segment.filename, error) && error) {
+		errorLog.SetError("Unable to delete " + segment.filename + ": " + error.message());
+	}
+	closedSegmentBytes -= segment.size;
+	closedSegments.pop_front();
+}
+
+void SpillQueue::Impl::DeleteWriteSegment()
+{
+	reader.reset();
+	readFile.close();
+	readFile.clear();
+	readingWriteSegment = false;
+
+	writeFile.close(); // first, so that no index gets written for nothing
+	writer.reset();
+	writeFile.clear();
+
+	std::error_code error;
+	if (!std::filesystem::remove(writeSegment.filename, error) && error) {
+		errorLog.SetError("Unable to delete " + writeSegment.filename + ": " + error.message());
+	}
+}
+
+uint64_t SpillQueue::Impl::GetByteCount()
+{
+	uint64_t byteCount = closedSegmentBytes;
+	if (writer) {
+		byteCount += writeSegmentBytes;
+	}
+	if (reader) {
+		const std::streamoff position = readFile.tellg();
+		if (position > 0 && static_cast<uint64_t>(position) <= byteCount) {
+			byteCount -= static_cast<uint64_t>(position);
+		}
+	}
+	return byteCount;
+}
+
+SpillQueue::SpillQueue(const RecordingSegmentSettings& settings, size_t blockSize)
+{
+	pimpl_ = new Impl(settings, blockSize);
+}
+
+SpillQueue::~SpillQueue()
+{
+	try {
+		if (pimpl_->writer) {
+			pimpl_->CloseWriteSegment();
+		}
+	}
+	catch (std::exception&) {
+		// nothing to do about it anymore
+	}
+	delete pimpl_;
+}
+
+bool SpillQueue::Push(const slaim::Message& msg)
+{
+	const uint64_t maxTotalBytes = pimpl_->settings.maxTotalBytes;
+	if (maxTotalBytes > 0 && pimpl_->GetByteCount() + msg.GetSize() > maxTotalBytes) {
+		pimpl_->errorLog.SetError("Spill queue full");
+		return false;
+	}
+
+	try {
+		if (!pimpl_->writer) {
+			pimpl_->OpenWriteSegment();
+		}
+		pimpl_->writer->Write(msg);
+		pimpl_->writeSegmentBytes += RecordingFormat::recordHeaderSize + msg.GetSize();
+		++pimpl_->writeSegmentMessageCount;
+		if (!pimpl_->writeFile) {
+			throw std::runtime_error("Error writing " + pimpl_->writeSegment.filename);
+		}
+	}
+	catch (std::exception& e) {
+		pimpl_->errorLog.SetError(e.what());
+		if (pimpl_->writer) {
+			pimpl_->CloseWriteSegment(); // try a new segment next time
+		}
+		return false;
+	}
+	++pimpl_->pushedMessageCount;
+
+	const uint64_t maxSegmentBytes = pimpl_->settings.maxSegmentBytes;
+	if (maxSegmentBytes > 0 && pimpl_->writer->GetBytesWritten() >= maxSegmentBytes) {
+		pimpl_->CloseWriteSegment();
+	}
+	return true;
+}
+
+bool SpillQueue::Pop(slaim::Message& msg)
+{
+	while (true) {
+		if (!pimpl_->reader) {
+			if (pimpl_->closedSegments.empty()) {
+				if (!pimpl_->writer || !pimpl_->OpenWriteSegmentForReading()) {
+					return false;
+				}
+			}
+			else if (!pimpl_->OpenReadSegment()) {
+				continue;
+			}
+		}
+		if (pimpl_->readingWriteSegment) {
+			if (!pimpl_->reader->Read(msg)) {
+				// the rest is still in the block being built
+				pimpl_->writer->Flush();
+				pimpl_->readFile.clear();
+				if (!pimpl_->reader->Read(msg)) {
+					pimpl_->errorLog.SetError("Unable to read back " + pimpl_->writeSegment.filename + " - skipping the rest of it");
+					pimpl_->DeleteWriteSegment();
+					return false;
+				}
+			}
+			++pimpl_->poppedMessageCount;
+			if (++pimpl_->writeSegmentReadCount == pimpl_->writeSegmentMessageCount) {
+				pimpl_->DeleteWriteSegment(); // caught up; nothing left to keep on disk
+			}
+			return true;
+		}
+		if (pimpl_->reader->Read(msg)) {
+			++pimpl_->poppedMessageCount;
+			return true;
+		}
+		pimpl_->DeleteReadSegment(); // read through (or the rest is truncated)
+	}
+}
+
+bool SpillQueue::IsEmpty() const
+{
+	return !pimpl_->reader && pimpl_->closedSegments.empty() && !pimpl_->writer;
+}
+
+void SpillQueue::Flush()
+{
+	if (pimpl_->writer) {
+		pimpl_->writer->Flush();
+		pimpl_->writeFile.flush();
+	}
+}
+
+uint64_t SpillQueue::GetByteCount() const
+{
+	return pimpl_->GetByteCount();
+}
+
+uint64_t SpillQueue::GetPushedMessageCount() const
+{
+	return pimpl_->pushedMessageCount;
+}
+
+uint64_t SpillQueue::GetPoppedMessageCount() const
+{
+	return pimpl_->poppedMessageCount;
+}
+
+std::string SpillQueue::GetError()
+{
+	return pimpl_->errorLog.GetError();
+}
+
+}
@@ -0,0 +1,71 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef CLAIM_SPILL_QUEUE_H
+#define CLAIM_SPILL_QUEUE_H
+
+#include "SegmentedRecording.h"
+
+#include <messaging/slaim/message.h>
+
+#include <string>
+
+namespace claim {
+
+//! A first-in, first-out queue of messages on disk, for when they do not fit in memory.
+/*! The messages are appended to recording segments (see RecordingSegmentSettings), and read
+	back from the oldest segment; a segment is deleted as soon as it has been read through.
+	Once the reader catches up with the segment being written, it reads that one as it is
+	written, so that popping right after pushing does not cost a segment of its own.
+	Only the blocks being written and read are kept in memory, however many messages there are.
+
+	Segments left in the directory by a previous run are picked up as the oldest messages,
+	so nothing is lost if the process is restarted meanwhile (except for messages that had not
+	been flushed to the disk yet). A segment that was only partly read is read again from the
+	beginning, so after a restart, some messages may be popped twice.
+
+	The retention limits of the settings are not applied: instead, Push() fails when the total
+	size on disk would exceed maxTotalBytes (zero = no limit). Not thread-safe.
+*/
+class SpillQueue {
+public:
+	//! Throws std::runtime_error if the directory cannot be created.
+	explicit SpillQueue(const RecordingSegmentSettings& settings, size_t blockSize = 64 * 1024);
+	~SpillQueue(); // closes the segment being written, but leaves the unread messages on disk
+
+	//! Returns false if the message could not be written (out of space, or a write error).
+	bool Push(const slaim::Message& msg);
+
+	//! Returns false if the queue is empty.
+	bool Pop(slaim::Message& msg);
+
+	bool IsEmpty() const;
+
+	//! Writes the current block to the disk, even if it is not full yet.
+	void Flush();
+
+	//! Roughly, the bytes on disk not yet read.
+	uint64_t GetByteCount() const;
+
+	uint64_t GetPushedMessageCount() const;
+	uint64_t GetPoppedMessageCount() const;
+
+	//! Returns the next error encountered, if any (see slaim::ErrorLog).
+	std::string GetError();
+
+private:
+	// make the class non-copyable
+	SpillQueue(const SpillQueue&);
+	SpillQueue& operator= (const SpillQueue&);
+
+	class Impl;
+	Impl* pimpl_;
+};
+
+}
+
+#endif // CLAIM_SPILL_QUEUE_H
@@ -22,22 +22,26 @@ public:
 		m_windowLength = 5.0;
 	}
 
-	void AddThroughput(size_t bytes) {
+	//! A batch of items can be added at once, which is much cheaper than adding them one by one.
+	void AddThroughput(size_t bytes, size_t items = 1) {
 		std::unique_lock<std::mutex> lock(m_mutex);
 		Maintain();
-		numcfc::TimeElapsed te;
-		te.ResetToCurrent();
-		m_throughputStatistics.push_back(std::make_pair(te, bytes));
+		Entry entry;
+		entry.time.ResetToCurrent();
+		entry.itemCount = items;
+		entry.byteCount = bytes;
+		m_throughputStatistics.push_back(entry);
 	}
 	std::pair<double, double> GetThroughputPerSec() {
 		std::unique_lock<std::mutex> lock(m_mutex);
 		Maintain();
 		std::pair<double, double> p;
-		p.first = m_throughputStatistics.size() / m_windowLength;
+		p.first = 0;
 		p.second = 0;
-		std::deque< std::pair<numcfc::TimeElapsed, size_t> >::iterator iter = m_throughputStatistics.begin(), iterEnd = m_throughputStatistics.end();
+		std::deque<Entry>::iterator iter = m_throughputStatistics.begin(), iterEnd = m_throughputStatistics.end();
 		for (; iter != iterEnd; iter++) {
-			p.second += iter->second / m_windowLength;
+			p.first += iter->itemCount / m_windowLength;
+			p.second += iter->byteCount / m_windowLength;
 		}
 		return p;
 	}
@@ -45,7 +49,7 @@ public:
 private:
 	void Maintain() {
 		while (!m_throughputStatistics.empty()) {
-			if (m_throughputStatistics.front().first.GetElapsedSeconds() >= m_windowLength) {
+			if (m_throughputStatistics.front().time.GetElapsedSeconds() >= m_windowLength) {
 				m_throughputStatistics.pop_front();
 			}
 			else {
@@ -53,8 +57,13 @@ private:
 			}
 		}
 	}
+	struct Entry {
+		numcfc::TimeElapsed time;
+		size_t itemCount;
+		size_t byteCount;
+	};
 	std::mutex m_mutex;
-	std::deque< std::pair<numcfc::TimeElapsed, size_t> > m_throughputStatistics; // first: item count, second: total bytes
+	std::deque<Entry> m_throughputStatistics;
 	double m_windowLength;
 };
 
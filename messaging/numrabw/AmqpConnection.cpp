@@ -0,0 +1,320 @@
+
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AmqpConnection.h"
+
+#include <amqp.h>
+#include <amqp_framing.h>
+#include <amqp_tcp_socket.h>
+
+#ifdef WIN32
+#include <winsock2.h> // for struct timeval
+#else
+#include <sys/time.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+namespace numrabw {
+
+namespace {
+    const amqp_channel_t channel = 1;
+
+    std::string ToString(amqp_bytes_t bytes)
+    {
+        return std::string(static_cast<const char*>(bytes.bytes), bytes.len);
+    }
+
+    amqp_bytes_t ToBytes(const std::string& text)
+    {
+        amqp_bytes_t bytes;
+        bytes.len = text.length();
+        bytes.bytes = const_cast<char*>(text.data());
+        return bytes;
+    }
+
+    std::string DescribeClose(const amqp_method_t& method)
+    {
+        std::ostringstream oss;
+        if (method.id == AMQP_CONNECTION_CLOSE_METHOD) {
+            const amqp_connection_close_t* close = static_cast<const amqp_connection_close_t*>(method.decoded);
+            oss << "connection closed by the server: " << close->reply_code << " " << ToString(close->reply_text);
+        }
+        else if (method.id == AMQP_CHANNEL_CLOSE_METHOD) {
+            const amqp_channel_close_t* close = static_cast<const amqp_channel_close_t*>(method.decoded);
+            oss << "channel closed by the server: " << close->reply_code << " " << ToString(close->reply_text);
+        }
+        else {
+            oss << "unexpected method 0x" << std::hex << method.id << " from the server";
+        }
+        return oss.str();
+    }
+
+    struct timeval ToTimeval(double seconds)
+    {
+        seconds = (std::max)(seconds, 0.0);
+        struct timeval tv;
+        tv.tv_sec = static_cast<long>(seconds);
+        tv.tv_usec = static_cast<long>((seconds - tv.tv_sec) * 1e6);
+        return tv;
+    }
+}
+
+class AmqpConnection::Impl {
+public:
+    Impl() : connection(amqp_new_connection()), failed(false), nextSequenceNumber(0) {}
+
+    // Throw, and mark the connection as failed, if the status or the reply is an error.
+    void Check(int status, const char* context);
+    void Check(const amqp_rpc_reply_t& reply, const char* context);
+    void CheckRpc(const char* context) { Check(amqp_get_rpc_reply(connection), context); }
+    [[noreturn]] void Fail(const std::string& error);
+
+    // throws if the connection or the channel is being closed
+    void HandleOtherFrame(const amqp_frame_t& frame);
+
+    amqp_connection_state_t connection;
+    bool failed;
+    uint64_t nextSequenceNumber; // 0 = no confirms
+};
+
+void AmqpConnection::Impl::Check(int status, const char* context)
+{
+    if (status != AMQP_STATUS_OK) {
+        Fail(std::string(context) + ": " + amqp_error_string2(status));
+    }
+}
+
+void AmqpConnection::Impl::Check(const amqp_rpc_reply_t& reply, const char* context)
+{
+    switch (reply.reply_type) {
+    case AMQP_RESPONSE_NORMAL:
+        return;
+    case AMQP_RESPONSE_LIBRARY_EXCEPTION:
+        Fail(std::string(context) + ": " + amqp_error_string2(reply.library_error));
+    case AMQP_RESPONSE_SERVER_EXCEPTION:
+        Fail(std::string(context) + ": " + DescribeClose(reply.reply));
+    default:
+        Fail(std::string(context) + ": no reply");
+    }
+}
+
+void AmqpConnection::Impl::Fail(const std::string& error)
+{
+    failed = true;
+    throw std::runtime_error(error);
+}
+
+void AmqpConnection::Impl::HandleOtherFrame(const amqp_frame_t& frame)
+{
+    if (frame.frame_type == AMQP_FRAME_METHOD) {
+        switch (frame.payload.method.id) {
+        case AMQP_CONNECTION_CLOSE_METHOD:
+        case AMQP_CHANNEL_CLOSE_METHOD:
+            Fail(DescribeClose(frame.payload.method));
+        case AMQP_BASIC_CANCEL_METHOD:
+            Fail("Consumer cancelled by the server");
+        default:
+            break;
+        }
+    }
+}
+
+AmqpConnection::AmqpConnection(const std::string& connectString, unsigned int heartbeatSeconds)
+{
+    std::string username = "guest";
+    std::string password = "guest";
+    std::string hostAndPort = connectString;
+    std::string vhost = "/";
+
+    const size_t at = hostAndPort.rfind('@');
+    if (at != std::string::npos) {
+        const std::string credentials = hostAndPort.substr(0, at);
+        hostAndPort = hostAndPort.substr(at + 1);
+        const size_t colon = credentials.find(':');
+        username = credentials.substr(0, colon);
+        password = colon == std::string::npos ? std::string() : credentials.substr(colon + 1);
+    }
+    const size_t slash = hostAndPort.find('/');
+    if (slash != std::string::npos) {
+        if (slash + 1 < hostAndPort.length()) {
+            vhost = hostAndPort.substr(slash + 1);
+        }
+        hostAndPort = hostAndPort.substr(0, slash);
+    }
+    std::string host = hostAndPort;
+    int port = 5672;
+    const size_t colon = hostAndPort.rfind(':');
+    if (colon != std::string::npos) {
+        host = hostAndPort.substr(0, colon);
+        port = atoi(hostAndPort.c_str() + colon + 1);
+    }
+    if (host.empty()) {
+        host = "localhost";
+    }
+
+    pimpl_ = new Impl;
+    try {
+        amqp_socket_t* socket = amqp_tcp_socket_new(pimpl_->connection);
+        if (socket == NULL) {
+            pimpl_->Fail("Unable to create a socket");
+        }
+        struct timeval timeout = ToTimeval(10.0);
+        pimpl_->Check(amqp_socket_open_noblock(socket, host.c_str(), port, &timeout), ("Unable to connect to " + host).c_str());
+        pimpl_->Check(amqp_login(pimpl_->connection, vhost.c_str(), 0, AMQP_DEFAULT_FRAME_SIZE, static_cast<int>(heartbeatSeconds), AMQP_SASL_METHOD_PLAIN, username.c_str(), password.c_str()), "Login");
+        amqp_channel_open(pimpl_->connection, channel);
+        pimpl_->CheckRpc("Opening a channel");
+    }
+    catch (std::exception&) {
+        amqp_destroy_connection(pimpl_->connection);
+        delete pimpl_;
+        throw;
+    }
+}
+
+AmqpConnection::~AmqpConnection()
+{
+    if (!pimpl_->failed) {
+        // a failed connection may not reply at all, so it is just dropped
+        amqp_channel_close(pimpl_->connection, channel, AMQP_REPLY_SUCCESS);
+        amqp_connection_close(pimpl_->connection, AMQP_REPLY_SUCCESS);
+    }
+    amqp_destroy_connection(pimpl_->connection);
+    delete pimpl_;
+}
+
+void AmqpConnection::DeclareExchange(const std::string& exchange, const std::string& type, bool durable)
+{
+    amqp_exchange_declare(pimpl_->connection, channel, ToBytes(exchange), ToBytes(type), 0, durable ? 1 : 0, 0, 0, amqp_empty_table);
+    pimpl_->CheckRpc("Declaring the exchange");
+}
+
+std::string AmqpConnection::DeclareExclusiveQueue()
+{
+    amqp_queue_declare_ok_t* ok = amqp_queue_declare(pimpl_->connection, channel, amqp_empty_bytes, 0, 0, 1, 0, amqp_empty_table);
+    pimpl_->CheckRpc("Declaring a queue");
+    return ToString(ok->queue);
+}
+
+void AmqpConnection::Bind(const std::string& queue, const std::string& exchange, const std::string& routingKey)
+{
+    amqp_queue_bind(pimpl_->connection, channel, ToBytes(queue), ToBytes(exchange), ToBytes(routingKey), amqp_empty_table);
+    pimpl_->CheckRpc("Binding a queue");
+}
+
+void AmqpConnection::Unbind(const std::string& queue, const std::string& exchange, const std::string& routingKey)
+{
+    amqp_queue_unbind(pimpl_->connection, channel, ToBytes(queue), ToBytes(exchange), ToBytes(routingKey), amqp_empty_table);
+    pimpl_->CheckRpc("Unbinding a queue");
+}
+
+void AmqpConnection::Qos(uint16_t prefetchCount)
+{
+    amqp_basic_qos(pimpl_->connection, channel, 0, prefetchCount, 0);
+    pimpl_->CheckRpc("Setting the prefetch count");
+}
+
+void AmqpConnection::Consume(const std::string& queue, bool noAck)
+{
+    amqp_basic_consume(pimpl_->connection, channel, ToBytes(queue), amqp_empty_bytes, 0, noAck ? 1 : 0, 0, amqp_empty_table);
+    pimpl_->CheckRpc("Starting to consume");
+}
+
+void AmqpConnection::Ack(uint64_t deliveryTag, bool multiple)
+{
+    pimpl_->Check(amqp_basic_ack(pimpl_->connection, channel, deliveryTag, multiple ? 1 : 0), "Acknowledging");
+}
+
+void AmqpConnection::Reject(uint64_t deliveryTag, bool requeue)
+{
+    pimpl_->Check(amqp_basic_reject(pimpl_->connection, channel, deliveryTag, requeue ? 1 : 0), "Rejecting");
+}
+
+bool AmqpConnection::Receive(slaim::Message& msg, uint64_t& deliveryTag, double maxSecondsToWait)
+{
+    amqp_maybe_release_buffers(pimpl_->connection);
+
+    struct timeval timeout = ToTimeval(maxSecondsToWait);
+    amqp_envelope_t envelope;
+    const amqp_rpc_reply_t reply = amqp_consume_message(pimpl_->connection, &envelope, &timeout, 0);
+
+    if (reply.reply_type == AMQP_RESPONSE_NORMAL) {
+        msg.m_type.assign(static_cast<const char*>(envelope.routing_key.bytes), envelope.routing_key.len);
+        msg.m_text.assign(static_cast<const char*>(envelope.message.body.bytes), envelope.message.body.len);
+        deliveryTag = envelope.delivery_tag;
+        amqp_destroy_envelope(&envelope);
+        return true;
+    }
+    if (reply.reply_type == AMQP_RESPONSE_LIBRARY_EXCEPTION && reply.library_error == AMQP_STATUS_TIMEOUT) {
+        return false;
+    }
+    if (reply.reply_type != AMQP_RESPONSE_LIBRARY_EXCEPTION || reply.library_error != AMQP_STATUS_UNEXPECTED_STATE) {
+        pimpl_->Check(reply, "Receiving");
+    }
+
+    // something other than a message: it has been peeked at, but not read yet
+    amqp_frame_t frame;
+    pimpl_->Check(amqp_simple_wait_frame(pimpl_->connection, &frame), "Receiving");
+    pimpl_->HandleOtherFrame(frame);
+    return false;
+}
+
+void AmqpConnection::SendHeartbeat()
+{
+    amqp_frame_t frame = amqp_frame_t();
+    frame.frame_type = AMQP_FRAME_HEARTBEAT;
+    frame.channel = 0;
+    pimpl_->Check(amqp_send_frame(pimpl_->connection, &frame), "Sending a heartbeat");
+}
+
+uint64_t AmqpConnection::Publish(const std::string& exchange, const std::string& routingKey, const std::string& body)
+{
+    pimpl_->Check(amqp_basic_publish(pimpl_->connection, channel, ToBytes(exchange), ToBytes(routingKey), 0, 0, NULL, ToBytes(body)), "Publishing");
+    return pimpl_->nextSequenceNumber > 0 ? pimpl_->nextSequenceNumber++ : 0;
+}
+
+void AmqpConnection::EnableConfirms()
+{
+    amqp_confirm_select(pimpl_->connection, channel);
+    pimpl_->CheckRpc("Enabling the confirms");
+    pimpl_->nextSequenceNumber = 1;
+}
+
+bool AmqpConnection::ReceiveConfirm(uint64_t& sequenceNumber, bool& multiple, bool& ack, double maxSecondsToWait)
+{
+    amqp_maybe_release_buffers(pimpl_->connection);
+
+    struct timeval timeout = ToTimeval(maxSecondsToWait);
+    amqp_frame_t frame;
+    const int status = amqp_simple_wait_frame_noblock(pimpl_->connection, &frame, &timeout);
+    if (status == AMQP_STATUS_TIMEOUT) {
+        return false;
+    }
+    pimpl_->Check(status, "Waiting for confirms");
+
+    if (frame.frame_type == AMQP_FRAME_METHOD && frame.payload.method.id == AMQP_BASIC_ACK_METHOD) {
+        const amqp_basic_ack_t* basicAck = static_cast<const amqp_basic_ack_t*>(frame.payload.method.decoded);
+        sequenceNumber = basicAck->delivery_tag;
+        multiple = basicAck->multiple != 0;
+        ack = true;
+        return true;
+    }
+    if (frame.frame_type == AMQP_FRAME_METHOD && frame.payload.method.id == AMQP_BASIC_NACK_METHOD) {
+        const amqp_basic_nack_t* basicNack = static_cast<const amqp_basic_nack_t*>(frame.payload.method.decoded);
+        sequenceNumber = basicNack->delivery_tag;
+        multiple = basicNack->multiple != 0;
+        ack = false;
+        return true;
+    }
+    pimpl_->HandleOtherFrame(frame);
+    return false;
+}
+
+}
@@ -0,0 +1,83 @@
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NUMRABW_AMQP_CONNECTION_H
+#define NUMRABW_AMQP_CONNECTION_H
+
+#include "../slaim/message.h"
+
+#include <stdint.h>
+#include <string>
+
+namespace numrabw {
+
+//! A connection with a single channel, on rabbitmq-c directly rather than amqpcpp, whose
+//! Consume() blocks inside its own read loop until a message arrives. Here, Receive() reads
+//! frames from the socket as they arrive, and waits for at most the time given, so the caller
+//! gets to do other things (apply subscription changes, notice that it should quit) within
+//! a bounded time. Heartbeats are sent and checked whenever Receive() is reading or waiting.
+//! Unlike amqpcpp, it also supports publisher confirms.
+//! All the member functions throw std::runtime_error on failure; the connection cannot be
+//! used after that.
+class AmqpConnection {
+public:
+    //! connectString: [username:password@]host[:port][/vhost], as made by claim::CreatePostOffice.
+    //! The defaults are guest:guest, port 5672, and vhost "/".
+    AmqpConnection(const std::string& connectString, unsigned int heartbeatSeconds);
+    ~AmqpConnection(); // closes the connection, unless it has failed
+
+    void DeclareExchange(const std::string& exchange, const std::string& type, bool durable);
+
+    //! Declares an exclusive queue with a name generated by the server, and returns the name.
+    std::string DeclareExclusiveQueue();
+
+    void Bind(const std::string& queue, const std::string& exchange, const std::string& routingKey);
+    void Unbind(const std::string& queue, const std::string& exchange, const std::string& routingKey);
+
+    //! Limits the number of messages sent to the consumer before it acknowledges them.
+    void Qos(uint16_t prefetchCount);
+
+    void Consume(const std::string& queue, bool noAck);
+
+    //! With multiple, acknowledges all the messages up to the delivery tag at once.
+    void Ack(uint64_t deliveryTag, bool multiple);
+
+    //! Settles a single message without acknowledging it; without requeue, the server discards it.
+    void Reject(uint64_t deliveryTag, bool requeue);
+
+    //! Returns the sequence number of the message for the confirms (1, 2, ...), or 0 if the
+    //! confirms have not been enabled.
+    uint64_t Publish(const std::string& exchange, const std::string& routingKey, const std::string& body);
+
+    //! Puts the channel in confirm mode: the server acknowledges the published messages, in
+    //! batches, once it has taken responsibility for them.
+    void EnableConfirms();
+
+    //! Returns false if no confirm arrived within maxSecondsToWait (which may be 0). With multiple,
+    //! all the messages up to the sequence number are confirmed at once. If !ack, the server
+    //! could not take the message(s), so they should be published again.
+    bool ReceiveConfirm(uint64_t& sequenceNumber, bool& multiple, bool& ack, double maxSecondsToWait);
+
+    //! Returns false if no message arrived within maxSecondsToWait (which may be 0), or if some
+    //! other frame arrived first. Frames that have been read already are handled without waiting.
+    bool Receive(slaim::Message& msg, uint64_t& deliveryTag, double maxSecondsToWait);
+
+    //! Sends a heartbeat right away. For when the caller cannot call Receive() for a while, so
+    //! that the server does not take it for dead meanwhile.
+    void SendHeartbeat();
+
+private:
+    // make the class non-copyable
+    AmqpConnection(const AmqpConnection&);
+    AmqpConnection& operator= (const AmqpConnection&);
+
+    class Impl;
+    Impl* pimpl_;
+};
+
+}
+
+#endif // NUMRABW_AMQP_CONNECTION_H
@@ -8,16 +8,66 @@
 
 #pragma once
 
-#include <numcfc/Time.h>
+#include "SpscRingBuffer.h"
+#include "MpscQueue.h"
+
 #include <mutex>
 #include <condition_variable>
 #include <deque>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <limits>
 #include <assert.h>
 
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#endif
+
 template <typename T>
 class LimitedSizeBuffer {
 public:
-    LimitedSizeBuffer() : m_maxItemCount(1024), m_maxByteCount(1024 * 1024), m_currentByteCount(0) {}
+    enum Mode {
+        Locked,                       // any number of producer and consumer threads
+        SingleProducerSingleConsumer, // lock-free, but only one producer thread and one consumer thread
+        MultipleProducersSingleConsumer, // lock-free, any number of producer threads but only one consumer thread
+    };
+
+    LimitedSizeBuffer() : m_mode(Locked), m_waitingConsumerCount(0), m_consumerWaiting(false), m_interrupted(false), m_spinMicroseconds(0), m_defaultTypeQuota(0, 0, 1), m_poppedFromCurrentSubQueue(0), m_maxItemCount(1024), m_maxByteCount(1024 * 1024), m_limitAllocatedBytes(false), m_shrinkPending(false), m_peakItemCount(0), m_currentItemCount(0), m_currentByteCount(0), m_currentAllocatedByteCount(0) {}
+
+    // Must be called before the buffer is shared between threads. In the single-producer mode,
+    // the maximum item count set before this call is also the capacity of the buffer (rounded
+    // up to a power of two); the limit can be lowered later, but not raised beyond that.
+    void SetMode(Mode mode) {
+        m_mode = mode;
+        m_ring.reset(mode == SingleProducerSingleConsumer ? new SpscRingBuffer<T>(m_maxItemCount) : NULL);
+        m_queue.reset(mode == MultipleProducersSingleConsumer ? new MpscQueue<T>() : NULL);
+    }
+
+    Mode GetMode() const { return m_mode; }
+
+    // "locked", "spsc" or "mpsc"
+    static bool ParseMode(const std::string& text, Mode& mode) {
+        if (text == "locked") {
+            mode = Locked;
+        }
+        else if (text == "spsc") {
+            mode = SingleProducerSingleConsumer;
+        }
+        else if (text == "mpsc") {
+            mode = MultipleProducersSingleConsumer;
+        }
+        else {
+            return false;
+        }
+        return true;
+    }
 
     void SetMaxItemCount(size_t maxItemCount) {
         std::unique_lock<std::mutex> lock(m_mutex);
@@ -29,85 +79,633 @@ public:
         m_maxByteCount = maxByteCount;
     }
 
-    bool push_back(const T& item) {
+    // Besides the logical size of the items (T::GetSize, e.g. the length of the contents), the
+    // buffer keeps count of the memory they take (T::GetAllocatedSize, plus the queue node in the
+    // mpsc mode), which may be several times more for small items. By default, the maximum byte
+    // count (and the per-type quotas) limit the logical size; with this set, the allocated size.
+    // Must be called before any items are pushed.
+    void SetLimitAllocatedBytes(bool limitAllocatedBytes) {
         std::unique_lock<std::mutex> lock(m_mutex);
-        if (m_items.size() >= m_maxItemCount) {
-            return false;
+        m_limitAllocatedBytes = limitAllocatedBytes;
+    }
+
+    bool GetLimitAllocatedBytes() const { return m_limitAllocatedBytes; }
+
+    // Per-type sub-queues (the locked mode only): with a non-zero default quota, each type of
+    // item (as returned by T::GetType) is queued separately, and limited to its own quota in
+    // addition to the overall limits. The items are popped round-robin across the types that
+    // have any, taking up to weight items of a type in a row. So one busy type can neither
+    // fill the whole buffer nor delay the items of other types by more than one round.
+    // A zero default quota puts all items in a single queue again (the default).
+    void SetDefaultTypeQuota(size_t maxItemCount, size_t maxByteCount) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        const bool wasFairShare = IsFairShare();
+        m_defaultTypeQuota = TypeQuota(maxItemCount, maxByteCount, 1);
+        for (auto& i : m_subQueues) {
+            if (m_typeQuotas.find(i.first) == m_typeQuotas.end()) {
+                i.second.quota = m_defaultTypeQuota;
+            }
+        }
+        if (IsFairShare() && !wasFairShare) {
+            std::deque<T> items;
+            items.swap(m_items);
+            for (T& item : items) {
+                PushToSubQueue(std::move(item), true);
+            }
         }
-        else if (m_currentByteCount + item.GetSize() >= m_maxByteCount && m_items.size() > 0) { // exception: allow large messages if the buffer is otherwise empty
+        else if (!IsFairShare() && wasFairShare) {
+            T item;
+            while (!m_roundRobin.empty()) {
+                PopFromSubQueue(item);
+                m_items.push_back(std::move(item));
+            }
+            m_subQueues.clear();
+        }
+    }
+
+    // Overrides the default quota of one type; a weight of 2 means twice as many items per round.
+    void SetTypeQuota(const std::string& type, size_t maxItemCount, size_t maxByteCount, unsigned int weight = 1) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        const TypeQuota quota(maxItemCount, maxByteCount, (std::max)(weight, 1u));
+        m_typeQuotas.erase(type);
+        m_typeQuotas.insert(std::make_pair(type, quota));
+        const auto i = m_subQueues.find(type);
+        if (i != m_subQueues.end()) {
+            i->second.quota = quota;
+        }
+    }
+
+    // True if the item cannot be pushed because of the quota of its type (rather than the
+    // overall limits); the caller may want to drop such items instead of waiting.
+    bool IsOverTypeQuota(const T& item) const {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!IsFairShare()) {
             return false;
         }
-        m_items.push_back(item);
-        m_currentByteCount += item.GetSize();
+        const auto i = m_subQueues.find(item.GetType());
+        return i != m_subQueues.end() && !i->second.HasRoomFor(GetLimitedSize(item));
+    }
 
-        { // signaling
-            {
-                std::lock_guard<std::mutex> lock(m_mutexSignaling);
-                m_notified = true;
+    // When a consumer is about to wait for items, it first polls the buffer for at most this
+    // long before going to sleep. This saves the wakeup latency of a sleeping thread whenever
+    // items arrive within the spin time, at the cost of burning a core meanwhile. 0 = no spin.
+    void SetSpinMicroseconds(unsigned int spinMicroseconds) {
+        m_spinMicroseconds = spinMicroseconds;
+    }
+
+    bool push_back(const T& item) {
+        if (m_mode != Locked) {
+            if (!TryPushLockFree(item)) {
+                return false;
             }
-            m_condSignaling.notify_one();
+            WakeConsumer();
+            return true;
         }
 
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!TryPushLocked(item)) {
+            return false;
+        }
+
+        const bool consumerWaiting = m_waitingConsumerCount > 0;
+        lock.unlock();
+        if (consumerWaiting) {
+            m_cond.notify_one();
+        }
         return true;
     }
+
+    // Appends items[first], items[first + 1], ... for as long as they fit, taking the lock only once.
+    // Returns the number of items appended.
+    size_t push_back_many(const std::vector<T>& items, size_t first = 0) {
+        size_t count = 0;
+        if (m_mode != Locked) {
+            for (size_t i = first, end = items.size(); i < end && TryPushLockFree(items[i]); ++i) {
+                ++count;
+            }
+            if (count > 0) {
+                WakeConsumer();
+            }
+            return count;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (size_t i = first, end = items.size(); i < end && TryPushLocked(items[i]); ++i) {
+            ++count;
+        }
+
+        const bool consumerWaiting = m_waitingConsumerCount > 0;
+        lock.unlock();
+        if (count > 1 && consumerWaiting) {
+            m_cond.notify_all();
+        }
+        else if (count > 0 && consumerWaiting) {
+            m_cond.notify_one();
+        }
+        return count;
+    }
+
     bool pop_front(T& item, double maxSecondsToWait = 0) {
-        if (m_items.empty()) {
-            if (maxSecondsToWait <= 0) {
+        if (m_mode != Locked) {
+            size_t byteCount = 0;
+            size_t allocatedByteCount = 0;
+            if (!WaitForItemsLockFree(maxSecondsToWait) || !TryPopLockFree(item, byteCount, allocatedByteCount)) {
                 return false;
             }
-            { // signaling
-                numcfc::TimeElapsed te;
-                te.ResetToCurrent();
-                std::unique_lock<std::mutex> lock(m_mutexSignaling);
-                double secondsLeft = maxSecondsToWait;
-                while (!m_notified && secondsLeft > 0) {
-                    m_condSignaling.wait_for(lock, std::chrono::milliseconds(static_cast<int>(secondsLeft * 1000)));
-                    if (!m_notified) {
-                        secondsLeft = maxSecondsToWait - te.GetElapsedSeconds();
-                        if (secondsLeft > 0.0 && secondsLeft <= 1.0) {
-                            numcfc::SleepMinimal(); // this is to prevent another loop in the normal case of returning false
-                            secondsLeft = maxSecondsToWait - te.GetElapsedSeconds();
-                        }
-                    }
-                }
-                if (m_notified) {
-                    m_notified = false;
-                }
-                else {
-                    return false;
-                }
+            ReleaseLockFree(1, byteCount, allocatedByteCount);
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
+        if (!WaitForItems(lock, maxSecondsToWait)) {
+            return false;
+        }
+        PopLocked(item);
+        return true;
+    }
+
+    // Appends up to maxCount items to the vector, taking the lock only once.
+    // Waits at most maxSecondsToWait for the first item. Returns the number of items appended.
+    size_t pop_front_many(std::vector<T>& items, size_t maxCount, double maxSecondsToWait = 0) {
+        if (m_mode != Locked) {
+            if (maxCount == 0 || !WaitForItemsLockFree(maxSecondsToWait)) {
+                return 0;
+            }
+            items.reserve(items.size() + (std::min)(maxCount, m_currentItemCount.load()));
+            size_t count = 0;
+            size_t byteCount = 0;
+            size_t allocatedByteCount = 0;
+            T item;
+            while (count < maxCount && TryPopLockFree(item, byteCount, allocatedByteCount)) {
+                items.push_back(std::move(item));
+                ++count;
+            }
+            ReleaseLockFree(count, byteCount, allocatedByteCount); // once for the whole batch
+            return count;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
+        if (maxCount == 0 || !WaitForItems(lock, maxSecondsToWait)) {
+            return 0;
+        }
+        const size_t count = (std::min)(maxCount, m_currentItemCount.load());
+        items.reserve(items.size() + count);
+        T item;
+        for (size_t i = 0; i < count; ++i) {
+            PopLocked(item);
+            items.push_back(std::move(item));
+        }
+        return count;
+    }
+
+    // Moves all the items (or at most maxCount) to the end of the deque; waits at most
+    // maxSecondsToWait for the first item. Returns the number of items moved. In the locked mode,
+    // if the deque is empty to begin with and can take all the items, the whole internal deque is
+    // swapped with it under the lock, in constant time however many items there are; and the
+    // (empty) deque passed in becomes the new internal one, so by passing the same deque each
+    // time, its allocation is recycled. (With the per-type sub-queues, the items are moved one by
+    // one, in their round-robin order.) Note that the items moved no longer count against the
+    // limits, so a caller that keeps them for a while should pass a maxCount.
+    size_t drain_into(std::deque<T>& items, double maxSecondsToWait = 0, size_t maxCount = (std::numeric_limits<size_t>::max)()) {
+        if (m_mode != Locked) {
+            if (maxCount == 0 || !WaitForItemsLockFree(maxSecondsToWait)) {
+                return 0;
             }
+            size_t count = 0;
+            size_t byteCount = 0;
+            size_t allocatedByteCount = 0;
+            T item;
+            while (count < maxCount && TryPopLockFree(item, byteCount, allocatedByteCount)) {
+                items.push_back(std::move(item));
+                ++count;
+            }
+            ReleaseLockFree(count, byteCount, allocatedByteCount);
+            return count;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
+        if (maxCount == 0 || !WaitForItems(lock, maxSecondsToWait)) {
+            return 0;
         }
+        const size_t count = (std::min)(maxCount, m_currentItemCount.load());
+        if (items.empty() && !IsFairShare() && count == m_currentItemCount) {
+            m_items.swap(items);
+            m_currentItemCount = 0;
+            m_currentByteCount = 0;
+            m_currentAllocatedByteCount = 0;
+            return count;
+        }
+        T item;
+        for (size_t i = 0; i < count; ++i) {
+            PopLocked(item);
+            items.push_back(std::move(item));
+        }
+        return count;
+    }
 
+    // Makes a consumer that is waiting for items return right away, as if it had timed out; or if
+    // none is waiting, the next one to wait. Lets another thread get the consumer's attention
+    // without pushing anything.
+    void interrupt_wait() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_interrupted = true;
+        }
+        m_cond.notify_all();
+    }
+
+    // In the lock-free modes, the two counts are read separately, so they are consistent
+    // with each other only when neither the producer nor the consumer is active.
+    std::pair<size_t, size_t> GetItemAndByteCount() const {
+        if (m_mode != Locked) {
+            return std::make_pair(m_currentItemCount.load(), m_currentByteCount.load());
+        }
         std::unique_lock<std::mutex> lock(m_mutex);
-        if (m_items.empty()) {
-            return false; // somebody else got it
+        std::pair<size_t, size_t> p(std::make_pair(m_currentItemCount.load(), m_currentByteCount.load()));
+        return p;
+    }
+
+    // See SetLimitAllocatedBytes.
+    size_t GetAllocatedByteCount() const {
+        return m_currentAllocatedByteCount.load();
+    }
+
+    // Meant to be called periodically, say every ten seconds. After a burst of more than
+    // lowItemCount items, once the buffer has held at most that many for a whole period (from
+    // one call to the next), releases the spare capacity of the internal storage, which would
+    // otherwise stay at the size of the burst, and returns true. Returns false otherwise.
+    // Only the locked mode has anything to release: the ring of the spsc mode is allocated
+    // once, and the nodes of the mpsc mode are freed as the items are popped; however, the
+    // items themselves leave free memory in the heap, so the end of a burst is reported anyway.
+    bool ShrinkAfterBurst(size_t lowItemCount) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        const size_t peakItemCount = m_peakItemCount.exchange(m_currentItemCount);
+        if (peakItemCount > lowItemCount) {
+            m_shrinkPending = true;
+            return false;
+        }
+        if (!m_shrinkPending) {
+            return false;
+        }
+        m_shrinkPending = false;
+        if (m_mode == Locked) {
+            ShrinkLocked();
+        }
+        return true;
+    }
+
+private:
+    struct TypeQuota {
+        TypeQuota(size_t maxItemCount, size_t maxByteCount, unsigned int weight) : maxItemCount(maxItemCount), maxByteCount(maxByteCount), weight(weight) {}
+        size_t maxItemCount;
+        size_t maxByteCount;
+        unsigned int weight;
+    };
+
+    struct SubQueue {
+        explicit SubQueue(const TypeQuota& quota) : quota(quota), byteCount(0) {}
+        bool HasRoomFor(size_t itemSize) const {
+            if (items.size() >= quota.maxItemCount) {
+                return false;
+            }
+            return byteCount + itemSize < quota.maxByteCount || items.empty(); // see push_back
+        }
+        TypeQuota quota;
+        std::deque<T> items;
+        size_t byteCount; // logical or allocated, whichever is limited
+    };
+
+    bool IsFairShare() const { return m_defaultTypeQuota.maxItemCount > 0; }
+
+    size_t GetAllocatedSize(const T& item) const {
+        return item.GetAllocatedSize() + (m_queue ? MpscQueue<T>::GetNodeOverhead() : 0);
+    }
+
+    size_t GetLimitedSize(const T& item) const {
+        return m_limitAllocatedBytes ? GetAllocatedSize(item) : item.GetSize();
+    }
+
+    // The locked mode; called with m_mutex held. The allocated size is counted as stored, which
+    // is what the item will take for as long as it is in the buffer; its copy may be more compact.
+    bool TryPushLocked(const T& item) {
+        const size_t limitedByteCount = m_limitAllocatedBytes ? m_currentAllocatedByteCount : m_currentByteCount;
+        if (m_currentItemCount >= m_maxItemCount) {
+            return false;
+        }
+        else if (limitedByteCount + GetLimitedSize(item) >= m_maxByteCount && m_currentItemCount > 0) { // exception: allow large messages if the buffer is otherwise empty
+            return false;
+        }
+        const T* stored = NULL;
+        if (IsFairShare()) {
+            stored = PushToSubQueue(item, false);
+            if (stored == NULL) {
+                return false;
+            }
+        }
+        else {
+            m_items.push_back(item);
+            stored = &m_items.back();
         }
-        item = m_items.front();
-        size_t newByteCount = m_currentByteCount - item.GetSize();
+        ++m_currentItemCount;
+        m_currentByteCount += stored->GetSize();
+        m_currentAllocatedByteCount += GetAllocatedSize(*stored);
+        if (m_currentItemCount > m_peakItemCount) {
+            m_peakItemCount = m_currentItemCount.load();
+        }
+        return true;
+    }
+
+    // A std::deque keeps (at least) the index of the blocks it has needed at its largest, and
+    // some implementations keep the blocks as well, so the items are moved to new ones. As they
+    // are moved, their own allocations stay as they are, and so do the counts.
+    static void ShrinkDeque(std::deque<T>& items) {
+        std::deque<T>(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end())).swap(items);
+    }
+
+    void ShrinkLocked() {
+        ShrinkDeque(m_items);
+        for (auto i = m_subQueues.begin(); i != m_subQueues.end(); ) {
+            if (i->second.items.empty()) {
+                i = m_subQueues.erase(i); // not in m_roundRobin, either; recreated when needed
+            }
+            else {
+                ShrinkDeque(i->second.items);
+                ++i;
+            }
+        }
+        std::deque<SubQueue*>(m_roundRobin.begin(), m_roundRobin.end()).swap(m_roundRobin);
+    }
+
+    void PopLocked(T& item) {
+        // measured before the item is moved out: moving into an item with allocations of its
+        // own may keep those, instead of taking over the ones that were counted
+        const T& front = IsFairShare() ? m_roundRobin.front()->items.front() : m_items.front();
+        const size_t byteCount = front.GetSize();
+        const size_t allocatedByteCount = GetAllocatedSize(front);
+        if (IsFairShare()) {
+            PopFromSubQueue(item);
+        }
+        else {
+            item = std::move(m_items.front());
+            m_items.pop_front();
+        }
+        size_t newByteCount = m_currentByteCount - byteCount;
         assert(newByteCount <= m_currentByteCount);
         m_currentByteCount = newByteCount;
-        m_items.pop_front();
-        assert((m_currentByteCount == 0) == m_items.empty());
+        assert(allocatedByteCount <= m_currentAllocatedByteCount);
+        m_currentAllocatedByteCount -= allocatedByteCount;
+        --m_currentItemCount;
+        assert((m_currentByteCount == 0) == (m_currentItemCount == 0));
+    }
+
+    // Does not touch the overall counts; with force, ignores the quota (when redistributing).
+    // Returns the item as stored, or NULL if there is no room for it.
+    template <typename U>
+    const T* PushToSubQueue(U&& item, bool force) {
+        const std::string& type = item.GetType();
+        auto i = m_subQueues.find(type);
+        if (i == m_subQueues.end()) {
+            const auto quota = m_typeQuotas.find(type);
+            i = m_subQueues.insert(std::make_pair(type, SubQueue(quota != m_typeQuotas.end() ? quota->second : m_defaultTypeQuota))).first;
+        }
+        SubQueue& subQueue = i->second;
+        if (!force && !subQueue.HasRoomFor(GetLimitedSize(item))) {
+            return NULL;
+        }
+        if (subQueue.items.empty()) {
+            m_roundRobin.push_back(&subQueue);
+        }
+        subQueue.items.push_back(std::forward<U>(item));
+        subQueue.byteCount += GetLimitedSize(subQueue.items.back());
+        return &subQueue.items.back();
+    }
+
+    void PopFromSubQueue(T& item) {
+        SubQueue& subQueue = *m_roundRobin.front();
+        subQueue.byteCount -= GetLimitedSize(subQueue.items.front()); // see PopLocked
+        item = std::move(subQueue.items.front());
+        subQueue.items.pop_front();
+        ++m_poppedFromCurrentSubQueue;
+        if (subQueue.items.empty()) {
+            m_roundRobin.pop_front();
+            m_poppedFromCurrentSubQueue = 0;
+        }
+        else if (m_poppedFromCurrentSubQueue >= subQueue.quota.weight) {
+            m_roundRobin.pop_front();
+            m_roundRobin.push_back(&subQueue); // the type's turn is over
+            m_poppedFromCurrentSubQueue = 0;
+        }
+    }
+
+    // The producer side of the lock-free modes. The item and the bytes are reserved before the
+    // item is published (the consumer releases them only after popping it), so the counts may
+    // exceed the contents of the buffer for a moment, but never the other way round. Reserving
+    // is a single atomic addition per count, even if many producers compete.
+    bool TryPushLockFree(const T& item) {
+        const size_t itemCount = m_currentItemCount.fetch_add(1) + 1;
+        if (itemCount > m_maxItemCount) {
+            --m_currentItemCount;
+            return false;
+        }
+        if (itemCount > m_peakItemCount.load(std::memory_order_relaxed)) {
+            m_peakItemCount.store(itemCount, std::memory_order_relaxed); // roughly: producers may overwrite each other's peaks
+        }
+        T copy(item); // to be moved in, which keeps its allocations as measured here
+        const size_t size = copy.GetSize();
+        const size_t allocatedSize = GetAllocatedSize(copy);
+        const size_t byteCount = m_currentByteCount.fetch_add(size);
+        const size_t allocatedByteCount = m_currentAllocatedByteCount.fetch_add(allocatedSize);
+        const bool full = m_limitAllocatedBytes
+            ? allocatedByteCount + allocatedSize >= m_maxByteCount && allocatedByteCount > 0
+            : byteCount + size >= m_maxByteCount && byteCount > 0; // see push_back
+        if (full) {
+            ReleaseLockFree(1, size, allocatedSize);
+            return false;
+        }
+        if (m_ring) {
+            if (!m_ring->try_push(std::move(copy), m_ring->capacity())) {
+                ReleaseLockFree(1, size, allocatedSize);
+                return false;
+            }
+        }
+        else {
+            m_queue->push(std::move(copy));
+        }
         return true;
     }
 
-    std::pair<size_t, size_t> GetItemAndByteCount() const {
+    void ReleaseLockFree(size_t itemCount, size_t byteCount, size_t allocatedByteCount) {
+        m_currentItemCount -= itemCount;
+        m_currentByteCount -= byteCount;
+        m_currentAllocatedByteCount -= allocatedByteCount;
+    }
+
+    // The consumer side of the lock-free modes. Adds the sizes of the item to be released to
+    // byteCount and allocatedByteCount.
+    bool TryPopLockFree(T& item, size_t& byteCount, size_t& allocatedByteCount) {
+        T popped; // measured before it is moved on (see PopLocked)
+        if (m_ring) {
+            if (!m_ring->try_pop(popped)) {
+                return false;
+            }
+        }
+        else {
+            while (!m_queue->try_pop(popped)) {
+                if (m_queue->empty()) {
+                    return false;
+                }
+                std::this_thread::yield(); // the next producer is in the middle of pushing
+            }
+        }
+        byteCount += popped.GetSize();
+        allocatedByteCount += GetAllocatedSize(popped);
+        item = std::move(popped);
+        return true;
+    }
+
+    bool IsEmptyLockFree() const {
+        return m_ring ? m_ring->empty() : m_queue->empty();
+    }
+
+    // Called by the producer after pushing, in the lock-free modes. In the common case that
+    // the consumer is busy rather than waiting, costs a fence and a load.
+    void WakeConsumer() {
+        std::atomic_thread_fence(std::memory_order_seq_cst); // order the push before reading the flag
+        if (m_consumerWaiting.load(std::memory_order_relaxed)) {
+            {
+                // the consumer holds the mutex from raising the flag until it waits
+                std::lock_guard<std::mutex> lock(m_mutex);
+            }
+            m_cond.notify_one();
+        }
+    }
+
+    static std::chrono::steady_clock::time_point GetDeadline(double maxSecondsToWait) {
+        const double maxSeconds = 365.0 * 24 * 60 * 60; // avoid overflowing the time point
+        const std::chrono::duration<double> timeout((std::min)(maxSecondsToWait, maxSeconds));
+        return std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+    }
+
+    // Cheap enough to poll; may be true a moment before an item can actually be popped.
+    bool MayHaveItems() const {
+        if (m_mode == Locked) {
+            return m_currentItemCount.load(std::memory_order_relaxed) > 0;
+        }
+        return !IsEmptyLockFree();
+    }
+
+    static void CpuRelax() {
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+        _mm_pause();
+#elif defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    // The optional spin phase: returns true as soon as there may be items, or false if there
+    // are none when the spin time (or the deadline, if earlier) has passed.
+    bool Spin(std::chrono::steady_clock::time_point deadline) const {
+        const unsigned int spinMicroseconds = m_spinMicroseconds.load(std::memory_order_relaxed);
+        if (spinMicroseconds == 0) {
+            return MayHaveItems();
+        }
+        const auto spinDeadline = (std::min)(deadline, std::chrono::steady_clock::now() + std::chrono::microseconds(spinMicroseconds));
+        do {
+            for (int i = 0; i < 64; ++i) { // reading the clock is much slower than polling
+                if (MayHaveItems()) {
+                    return true;
+                }
+                CpuRelax();
+            }
+        } while (std::chrono::steady_clock::now() < spinDeadline);
+        return MayHaveItems();
+    }
+
+    // In the locked mode: locks the (deferred) lock, and returns true if there are items,
+    // after waiting at most maxSecondsToWait for them to arrive.
+    bool WaitForItems(std::unique_lock<std::mutex>& lock, double maxSecondsToWait) {
+        if (maxSecondsToWait <= 0) {
+            lock.lock();
+            return m_currentItemCount > 0;
+        }
+        const auto deadline = GetDeadline(maxSecondsToWait);
+        Spin(deadline);
+        lock.lock();
+        if (m_currentItemCount == 0 && !m_interrupted) {
+            ++m_waitingConsumerCount;
+            m_cond.wait_until(lock, deadline, [this] { return m_currentItemCount > 0 || m_interrupted; });
+            --m_waitingConsumerCount;
+        }
+        m_interrupted = false;
+        return m_currentItemCount > 0;
+    }
+
+    bool WaitForItemsLockFree(double maxSecondsToWait) {
+        if (!IsEmptyLockFree()) {
+            return true;
+        }
+        if (maxSecondsToWait <= 0) {
+            return false;
+        }
+        const auto deadline = GetDeadline(maxSecondsToWait);
+        if (Spin(deadline)) {
+            return true;
+        }
         std::unique_lock<std::mutex> lock(m_mutex);
-        std::pair<size_t, size_t> p(std::make_pair(m_items.size(), m_currentByteCount));
-        return p;
+        while (true) {
+            m_consumerWaiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst); // order raising the flag before checking the buffer (see WakeConsumer)
+            if (!IsEmptyLockFree()) {
+                m_consumerWaiting.store(false, std::memory_order_relaxed);
+                return true;
+            }
+            if (m_interrupted) {
+                m_interrupted = false;
+                m_consumerWaiting.store(false, std::memory_order_relaxed);
+                return false;
+            }
+            const bool timedOut = m_cond.wait_until(lock, deadline) == std::cv_status::timeout;
+            m_consumerWaiting.store(false, std::memory_order_relaxed);
+            if (!IsEmptyLockFree()) {
+                return true;
+            }
+            if (timedOut || m_interrupted) {
+                m_interrupted = false;
+                return false;
+            }
+        }
     }
 
-private:
-    mutable std::mutex m_mutex;
+    Mode m_mode;
 
-    // for signaling
-    mutable bool m_notified;
-    mutable std::mutex m_mutexSignaling;
-    mutable std::condition_variable m_condSignaling;
+    // In the locked mode, protects the items; in all modes, consumers wait on the condition
+    // variable with the mutex held, so that a producer cannot notify between their last check
+    // and the wait.
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cond;
+    size_t m_waitingConsumerCount; // in the locked mode
+    std::atomic<bool> m_consumerWaiting; // in the lock-free modes
+    bool m_interrupted; // see interrupt_wait
+    std::atomic<unsigned int> m_spinMicroseconds;
 
     std::deque<T> m_items;
-    size_t m_maxItemCount;
-    size_t m_maxByteCount;
-    size_t m_currentByteCount;
+
+    // the per-type sub-queues, instead of m_items
+    TypeQuota m_defaultTypeQuota;
+    std::unordered_map<std::string, TypeQuota> m_typeQuotas;
+    std::unordered_map<std::string, SubQueue> m_subQueues; // the types seen so far
+    std::deque<SubQueue*> m_roundRobin; // the non-empty sub-queues, whose turn it is first
+    unsigned int m_poppedFromCurrentSubQueue;
+
+    std::unique_ptr<SpscRingBuffer<T>> m_ring; // in the lock-free modes, instead of m_items
+    std::unique_ptr<MpscQueue<T>> m_queue;
+    std::atomic<size_t> m_maxItemCount;
+    std::atomic<size_t> m_maxByteCount;
+    bool m_limitAllocatedBytes;
+    bool m_shrinkPending; // there has been a burst since the storage was last shrunk
+    std::atomic<size_t> m_peakItemCount; // since the previous ShrinkAfterBurst
+    alignas(64) std::atomic<size_t> m_currentItemCount;
+    alignas(64) std::atomic<size_t> m_currentByteCount;
+    std::atomic<size_t> m_currentAllocatedByteCount; // on the same cache line: updated together
 };
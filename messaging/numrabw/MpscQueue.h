@@ -0,0 +1,122 @@
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+#ifdef _MSC_VER
+#pragma warning (push)
+#pragma warning (disable: 4324) // structure was padded due to alignment specifier
+#endif // _MSC_VER
+
+// An unbounded, intrusive, lock-free queue for any number of producer threads and exactly
+// one consumer thread (after Dmitry Vyukov's node-based MPSC queue). A push is a single
+// atomic exchange, so the producers never retry or wait for each other, no matter how many
+// of them there are; the consumer does not contend with them except on an empty queue.
+// Each item lives in a node of its own, allocated by the producer and freed by the consumer.
+template <typename T>
+class MpscQueue {
+public:
+    static const size_t cacheLineSize = 64;
+
+    MpscQueue() : m_head(&m_stub), m_tail(&m_stub) {
+        m_stub.next.store(NULL, std::memory_order_relaxed);
+    }
+
+    ~MpscQueue() {
+        T item;
+        while (try_pop(item))
+            ;
+    }
+
+    // Any thread.
+    template <typename U>
+    void push(U&& item) {
+        Link(new Node(std::forward<U>(item)));
+    }
+
+    // Consumer only. May fail even if the queue is not empty, if the producer of the next
+    // item is right in the middle of push(); see empty().
+    bool try_pop(T& item) {
+        NodeBase* tail = m_tail;
+        NodeBase* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &m_stub) {
+            if (next == NULL) {
+                return false;
+            }
+            m_tail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next != NULL) {
+            m_tail = next;
+            return Take(tail, item);
+        }
+        if (tail != m_head.load(std::memory_order_acquire)) {
+            return false; // a producer has not linked its node yet
+        }
+        // tail is the last node: push the stub behind it, so that it can be taken
+        Link(&m_stub);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next != NULL) {
+            m_tail = next;
+            return Take(tail, item);
+        }
+        return false;
+    }
+
+    // Consumer only. Returns false as soon as a producer has started to push.
+    bool empty() const {
+        return m_tail == &m_stub && m_head.load(std::memory_order_acquire) == &m_stub;
+    }
+
+    // Roughly, the memory taken per item in addition to the item itself: the link,
+    // and the typical overhead of the heap for the node.
+    static size_t GetNodeOverhead() {
+        return sizeof(Node) - sizeof(T) + 2 * sizeof(void*);
+    }
+
+private:
+    // make the class non-copyable
+    MpscQueue(const MpscQueue&);
+    MpscQueue& operator= (const MpscQueue&);
+
+    struct NodeBase {
+        std::atomic<NodeBase*> next;
+    };
+
+    struct Node : public NodeBase {
+        template <typename U>
+        explicit Node(U&& item) : item(std::forward<U>(item)) {}
+        T item;
+    };
+
+    void Link(NodeBase* node) {
+        node->next.store(NULL, std::memory_order_relaxed);
+        NodeBase* previous = m_head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    bool Take(NodeBase* node, T& item) {
+        Node* n = static_cast<Node*>(node);
+        item = std::move(n->item);
+        delete n;
+        return true;
+    }
+
+    // the most recently pushed node; written by the producers
+    alignas(cacheLineSize) std::atomic<NodeBase*> m_head;
+
+    // the next node to pop; owned by the consumer
+    alignas(cacheLineSize) NodeBase* m_tail;
+    NodeBase m_stub;
+};
+
+#ifdef _MSC_VER
+#pragma warning (pop)
+#endif // _MSC_VER
@@ -0,0 +1,121 @@
+//           Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#ifdef _MSC_VER
+#pragma warning (push)
+#pragma warning (disable: 4324) // structure was padded due to alignment specifier
+#endif // _MSC_VER
+
+// A bounded, lock-free ring buffer for exactly one producer thread and one consumer thread.
+// The head and the tail live on cache lines of their own, and each side keeps a cached copy
+// of the other side's index, so in the steady state neither side touches the other's cache
+// line except when the cached copy says the ring is full (or empty).
+// The slots are raw storage: an item is move-constructed in by try_push, and moved out and
+// destroyed by try_pop, so unused slots cost no more than their (lazily committed) memory.
+template <typename T>
+class SpscRingBuffer {
+public:
+    static const size_t cacheLineSize = 64;
+
+    explicit SpscRingBuffer(size_t minCapacity)
+        : m_capacity(RoundUpToPowerOfTwo(minCapacity))
+        , m_mask(m_capacity - 1)
+        , m_slots(static_cast<Slot*>(::operator new(m_capacity * sizeof(Slot))))
+        , m_head(0)
+        , m_cachedTail(0)
+        , m_tail(0)
+        , m_cachedHead(0)
+    {}
+
+    ~SpscRingBuffer() {
+        T item;
+        while (try_pop(item))
+            ;
+        ::operator delete(m_slots);
+    }
+
+    size_t capacity() const { return m_capacity; }
+
+    // Producer only. Fails if maxCount items are already in the ring (or the ring is full).
+    template <typename U>
+    bool try_push(U&& item, size_t maxCount) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead >= maxCount || tail - m_cachedHead >= m_capacity) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead >= maxCount || tail - m_cachedHead >= m_capacity) {
+                return false;
+            }
+        }
+        new (&m_slots[tail & m_mask]) T(std::forward<U>(item));
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only.
+    bool try_pop(T& item) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail) {
+                return false;
+            }
+        }
+        T* slot = reinterpret_cast<T*>(&m_slots[head & m_mask]);
+        item = std::move(*slot);
+        slot->~T();
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // From any thread; exact only when neither side is active.
+    size_t size() const {
+        const size_t head = m_head.load(std::memory_order_acquire);
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    bool empty() const { return size() == 0; }
+
+private:
+    // make the class non-copyable
+    SpscRingBuffer(const SpscRingBuffer&);
+    SpscRingBuffer& operator= (const SpscRingBuffer&);
+
+    static size_t RoundUpToPowerOfTwo(size_t n) {
+        size_t capacity = 1;
+        while (capacity < n) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    const size_t m_capacity;
+    const size_t m_mask;
+    Slot* const m_slots;
+
+    // written by the consumer
+    alignas(cacheLineSize) std::atomic<size_t> m_head;
+    size_t m_cachedTail;
+
+    // written by the producer
+    alignas(cacheLineSize) std::atomic<size_t> m_tail;
+    size_t m_cachedHead; // (the alignment pads the object up to a full cache line, too)
+};
+
+#ifdef _MSC_VER
+#pragma warning (pop)
+#endif // _MSC_VER
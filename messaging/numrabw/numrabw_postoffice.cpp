@@ -8,8 +8,7 @@
 #include "numrabw_postoffice.h"
 
 #include "LimitedSizeBuffer.h"
-
-#include "amqpcpp/include/AMQPcpp.h"
+#include "AmqpConnection.h"
 
 #include "crossguid/Guid.hpp"
 
@@ -19,6 +18,7 @@
 
 #include <messaging/claim/ThroughputStatistics.h>
 #include <messaging/claim/AttributeMessage.h>
+#include <messaging/claim/SpillQueue.h>
 
 #include <memory>
 #include <sstream>
@@ -26,7 +26,8 @@
 #include <chrono>
 #include <atomic>
 #include <unordered_map>
-#include <future>
+#include <algorithm>
+#include <cstring>
 
 #ifdef WIN32
 //#ifdef _DEBUG
@@ -34,8 +35,22 @@
 //#endif // _DEBUG
 #endif // WIN32
 
+#if defined(WIN32) || defined(__GLIBC__)
+#include <malloc.h> // for _heapmin and malloc_trim
+#endif
+
 namespace {
     const char* exchangeName = "Numcore_messaging_library";
+
+    // Returns free heap memory to the operating system, where the heap does not do so by itself.
+    void TrimHeap()
+    {
+#if defined(WIN32)
+        _heapmin();
+#elif defined(__GLIBC__)
+        malloc_trim(0);
+#endif
+    }
 }
 
 namespace numrabw {
@@ -54,15 +69,44 @@ public:
     void RunReceiverThread(const std::string& connectString);
     void RunSenderThread(const std::string& connectString);
 
-    // return non-zero to stop consuming (for the time being at least)
-    int HandleReceivedMessage(AMQPMessage* m);
+    bool HandleReceivedMessage(AmqpConnection& connection, slaim::Message& msg, uint64_t deliveryTag); // returns true if the message was put to the buffer
+    void ApplySubscribeActions(AmqpConnection& connection, const std::string& queue, std::set<slaim::MessageType>& mySubscriptions);
+    void AckDequeuedMessages(AmqpConnection& connection, uint64_t minCount); // can be called from the receiver thread only
 
     const char* GetVersion() const;
 
     // can be called from the sender thread only
     slaim::Message GetStatusMessage();
 
-    void DeclareQueue(AMQPQueue* queue) const;
+    // returns false if the mode is not known
+    bool ParseBufferMode(const std::string& text, const char* bufferName, LimitedSizeBuffer<slaim::Message>::Mode& mode);
+
+    // "type=items/megabytes/weight, ..."
+    void SetReceiveTypeQuotas(const std::string& text);
+
+    // The spill queue; can be called from the sender thread only.
+    bool IsDrainingSpillQueue() const;
+    bool SpillBatch(std::deque<slaim::Message>& batch); // returns false if not all could be spilled
+    void SpillFor(double seconds, std::deque<slaim::Message>& batch);
+    void DrainSpillQueue(AmqpConnection& connection, double& drainAllowance, std::chrono::steady_clock::time_point& lastDrainTime);
+    void ReportSpillQueueErrors();
+
+    // When the sender thread is exiting: spills whatever has not been sent (or confirmed), if
+    // possible, and reports the rest. Can be called from the sender thread only.
+    void KeepUnsentOnExit(std::deque<slaim::Message>& batch);
+
+    // can be called from the sender thread only
+    void PublishActivity(AmqpConnection& connection);
+    void ShrinkAfterBurst(std::deque<slaim::Message>& batch);
+    void PublishBatch(AmqpConnection& connection, std::deque<slaim::Message>& batch);
+
+    // The publisher confirms; can be called from the sender thread only. Nacked messages, and
+    // after a reconnect all the unconfirmed ones, are put to the front of the republish queue.
+    void KeepUntilConfirmed(uint64_t sequenceNumber, slaim::Message& msg);
+    void WaitForConfirmWindow(AmqpConnection& connection);
+    void HandleConfirms(AmqpConnection& connection, double maxSecondsToWait);
+    void WaitForConfirmsOnExit(AmqpConnection& connection);
+    void RequeueUnconfirmed();
 
     const std::string clientIdentifier;
 
@@ -72,7 +116,13 @@ public:
     std::atomic<bool> senderOk = false;
     std::atomic<bool> killed = false;
 
+    // The receiver thread waits for messages at most receiverPollMilliseconds at a time, but in
+    // order to apply subscription changes right away, it is woken up by publishing a message to
+    // its own queue. This is done by the sender thread, on its connection: Activity() just sets
+    // the flag, and interrupts the sender's wait for messages. However many times it is set,
+    // one message is published.
     const std::string activityRoutingKey = "numrabw_activity_" + std::string(xg::newGuid());
+    std::atomic<bool> activityPending = false;
     const numcfc::Time timeStarted;
 
     struct SubscribeAction {
@@ -85,6 +135,68 @@ public:
     LimitedSizeBuffer<slaim::Message> recvBuffer;
     LimitedSizeBuffer<slaim::Message> sendBuffer;
 
+    // optional; used by the sender thread only
+    std::unique_ptr<claim::SpillQueue> spillQueue;
+    slaim::Message spilledMessage; // popped from the spill queue, but not published yet
+    bool spilledMessagePending = false;
+    std::atomic<unsigned int> spillDrainMessagesPerSecond = 0; // 0 = no limit
+
+    std::atomic<size_t> recvOverQuotaDropCount = 0;
+
+    std::atomic<size_t> sendBatchMaxMessages = 1024;
+    std::atomic<size_t> sendBatchMaxBytes = 1024 * 1024;
+    std::atomic<unsigned int> sendBatchLingerMicroseconds = 0;
+
+    // For Flush(): the sender thread settles a count once all the messages accepted up to it
+    // have been published (and confirmed), and nothing is left in the spill queue either.
+    std::atomic<uint64_t> sendAcceptedCount = 0;
+    std::atomic<uint64_t> sendSettledCount = 0;
+
+    // Optional; used by the sender thread only. With confirms, up to sendConfirmWindow messages
+    // are published before the broker confirms the first of them, so the throughput does not
+    // depend on the round-trip time; they are kept, oldest first, until confirmed. As they may
+    // be published again after a reconnect, a message can arrive twice, but it is not lost.
+    struct UnconfirmedMessage {
+        uint64_t sequenceNumber;
+        slaim::Message msg;
+        std::chrono::steady_clock::time_point publishTime;
+    };
+    std::atomic<size_t> sendConfirmWindow = 0; // 0 = no confirms; read when connecting
+    bool senderConfirms = false; // in the current connection
+    std::deque<UnconfirmedMessage> unconfirmed;
+    std::deque<slaim::Message> republish; // published before anything else, and never spilled behind newer messages
+    size_t confirmCount = 0; // since the previous status message
+    double confirmLatencySum = 0.0;
+    double confirmLatencyMax = 0.0;
+    size_t nackCount = 0;
+    size_t republishCount = 0;
+
+    // Optional; used by the receiver thread only, except for the dequeued count. With acks, the
+    // broker sends at most recvPrefetchCount messages that have not been acknowledged, and they
+    // are acknowledged as the application takes them from the receive buffer, so the buffer
+    // does not hold more than that. The delivery tags of the buffered messages are kept in the
+    // same order; as the application takes n messages, the n oldest are acknowledged, all at
+    // once (with the per-type quotas, the order in which they are taken may differ a bit). The
+    // messages dropped for being over their type's quota are rejected right away, so they are
+    // not taken for handled; as the broker would close the channel if such a tag were then
+    // acknowledged, the acks stop short of it. The tags of the other messages that do not go
+    // to the buffer are acknowledged along with the rest.
+    std::atomic<unsigned int> recvPrefetchCount = 0; // 0 = no acks; read when connecting
+    bool receiverAcks = false; // in the current connection
+    std::deque<uint64_t> bufferedDeliveryTags;
+    size_t staleDeliveryTagCount = 0; // at the front, from a previous connection
+    std::atomic<uint64_t> recvDequeuedCount = 0; // by the application
+    uint64_t recvDequeuedCountSeen = 0;
+    uint64_t lastDeliveryTag = 0;
+    uint64_t lastAckedDeliveryTag = 0; // or rejected: all up to this are settled
+    std::deque<uint64_t> rejectedDeliveryTags; // after lastAckedDeliveryTag
+
+    std::atomic<unsigned int> receiverPollMilliseconds = 100;
+    std::atomic<unsigned int> receiverHeartbeatSeconds = 60; // read when connecting
+
+    std::atomic<unsigned int> bufferShrinkSeconds = 10; // 0 = never
+    std::atomic<bool> trimHeapAfterBurst = false;
+
     claim::ThroughputStatistics recvThroughput;
     claim::ThroughputStatistics sendThroughput;
 
@@ -96,43 +208,40 @@ public:
 
     std::string username;
 
-    std::mutex activityFuturesMutex;
-    std::deque<std::future<void>> activityFutures;
 };
 
-void DeclareExchange(AMQPExchange* exchange)
-{
-    exchange->Declare(exchangeName, "topic", AMQP_DURABLE);
-}
-
-void PostOffice::Pimpl::DeclareQueue(AMQPQueue* queue) const
-{
-    queue->Declare("", AMQP_EXCLUSIVE);
-    queue->Bind(exchangeName, activityRoutingKey);
-}
-
 void PostOffice::Pimpl::RunReceiverThread(const std::string& connectString)
 {
     std::set<slaim::MessageType> mySubscriptions;
     bool error = false;
 
+    // the most messages handled in a row, before checking for other things to do
+    const size_t maxMessagesPerWakeup = 1024;
+
     while (!killed) {
         try {
-            AMQP amqp(connectString);
-            AMQPExchange* exchange = amqp.createExchange();
-            DeclareExchange(exchange);
-            AMQPQueue* queue = amqp.createQueue();
-            DeclareQueue(queue);
+            AmqpConnection connection(connectString, receiverHeartbeatSeconds);
+            connection.DeclareExchange(exchangeName, "topic", true);
+            const std::string queue = connection.DeclareExclusiveQueue();
+            connection.Bind(queue, exchangeName, activityRoutingKey);
 
             for (const auto& messageType : mySubscriptions) {
-                queue->Bind(exchangeName, messageType);
+                connection.Bind(queue, exchangeName, messageType);
             }
 
-            std::function<int(AMQPMessage*)> onMessage = [this](AMQPMessage* m) {
-                return HandleReceivedMessage(m);
-            };
+            const unsigned int prefetchCount = (std::min)(recvPrefetchCount.load(), 65535u);
+            receiverAcks = prefetchCount > 0;
+            if (receiverAcks) {
+                connection.Qos(static_cast<uint16_t>(prefetchCount));
+            }
+            staleDeliveryTagCount = bufferedDeliveryTags.size();
+            lastDeliveryTag = 0;
+            lastAckedDeliveryTag = 0;
+            rejectedDeliveryTags.clear();
+            connection.Consume(queue, !receiverAcks);
 
-            queue->addEvent(AMQP_MESSAGE, onMessage);
+            // rather than a round trip per message, or a stall waiting for the last one
+            const uint64_t ackBatchSize = (std::max)(1u, prefetchCount / 4);
 
             receiverOk = true;
             if (error) {
@@ -141,20 +250,28 @@ void PostOffice::Pimpl::RunReceiverThread(const std::string& connectString)
                 errorLog.SetError("Receiver now ok");
             }
 
+            slaim::Message msg;
+            uint64_t deliveryTag = 0;
+
             while (!killed) {
-                SubscribeAction subscribeAction;
-                while (pendingSubscribeActions.pop_front(subscribeAction)) {
-                    if (subscribeAction.subscribe) {
-                        mySubscriptions.insert(subscribeAction.messageType);
-                        queue->Bind(exchangeName, subscribeAction.messageType);
-                    }
-                    else {
-                        mySubscriptions.erase(subscribeAction.messageType);
-                        queue->unBind(exchangeName, subscribeAction.messageType);
+                ApplySubscribeActions(connection, queue, mySubscriptions);
+
+                // Wait for the first message, and then handle whatever else has arrived already,
+                // so a burst costs one wakeup rather than one per message.
+                double maxSecondsToWait = receiverPollMilliseconds * 1e-3;
+                AckDequeuedMessages(connection, 1);
+                if (receiverAcks && lastAckedDeliveryTag < lastDeliveryTag) {
+                    // the application taking messages does not wake this thread up
+                    maxSecondsToWait = (std::min)(maxSecondsToWait, 0.001);
+                }
+                for (size_t i = 0; i < maxMessagesPerWakeup && !killed && connection.Receive(msg, deliveryTag, maxSecondsToWait); ++i) {
+                    if (HandleReceivedMessage(connection, msg, deliveryTag)) {
+                        bufferedDeliveryTags.push_back(deliveryTag);
                     }
+                    lastDeliveryTag = deliveryTag;
+                    AckDequeuedMessages(connection, ackBatchSize);
+                    maxSecondsToWait = 0.0;
                 }
-
-                queue->Consume(AMQP_NOACK);
             }
         }
         catch (std::exception& e) {
@@ -169,30 +286,74 @@ void PostOffice::Pimpl::RunReceiverThread(const std::string& connectString)
     }
 }
 
-int PostOffice::Pimpl::HandleReceivedMessage(AMQPMessage* m)
+void PostOffice::Pimpl::ApplySubscribeActions(AmqpConnection& connection, const std::string& queue, std::set<slaim::MessageType>& mySubscriptions)
 {
-    slaim::Message msg;
-    msg.m_type = m->getRoutingKey();
-
-    if (msg.m_type == activityRoutingKey) {
-        return 1; // triggered activity
+    SubscribeAction subscribeAction;
+    while (pendingSubscribeActions.pop_front(subscribeAction)) {
+        if (subscribeAction.subscribe) {
+            mySubscriptions.insert(subscribeAction.messageType);
+            connection.Bind(queue, exchangeName, subscribeAction.messageType);
+        }
+        else {
+            mySubscriptions.erase(subscribeAction.messageType);
+            connection.Unbind(queue, exchangeName, subscribeAction.messageType);
+        }
     }
+}
 
-    size_t messageLength = 0;
-    const char *data = m->getMessage(&messageLength);
-    if (messageLength > 0) {
-        msg.m_text = std::string(data, data + messageLength);
-        if (messageLength != msg.m_text.length()) {
-            std::ostringstream error;
-            error << "Message size mismatch: " << messageLength << " != " << msg.m_text.length();
-            std::lock_guard<std::mutex> lock(errorLogMutex);
-            errorLog.SetError(error.str());
-            return 2;
+void PostOffice::Pimpl::AckDequeuedMessages(AmqpConnection& connection, uint64_t minCount)
+{
+    const uint64_t dequeuedCount = recvDequeuedCount;
+    for (; recvDequeuedCountSeen < dequeuedCount && !bufferedDeliveryTags.empty(); ++recvDequeuedCountSeen) {
+        bufferedDeliveryTags.pop_front();
+        if (staleDeliveryTagCount > 0) {
+            --staleDeliveryTagCount;
         }
     }
+    if (!receiverAcks) {
+        return;
+    }
+
+    // everything before the oldest message still in the buffer
+    const uint64_t settleUpTo = bufferedDeliveryTags.size() > staleDeliveryTagCount ? bufferedDeliveryTags[staleDeliveryTagCount] - 1 : lastDeliveryTag;
+    if (settleUpTo < lastAckedDeliveryTag + minCount) {
+        return;
+    }
+
+    // except for the rejected ones at the end: those are settled already
+    uint64_t ackUpTo = settleUpTo;
+    auto rejected = std::upper_bound(rejectedDeliveryTags.begin(), rejectedDeliveryTags.end(), settleUpTo);
+    while (rejected != rejectedDeliveryTags.begin() && *(rejected - 1) == ackUpTo) {
+        --rejected;
+        --ackUpTo;
+    }
+    if (ackUpTo > lastAckedDeliveryTag) {
+        connection.Ack(ackUpTo, true); // skips the rejected ones within the range
+    }
+    lastAckedDeliveryTag = settleUpTo;
+    rejectedDeliveryTags.erase(rejectedDeliveryTags.begin(), std::upper_bound(rejectedDeliveryTags.begin(), rejectedDeliveryTags.end(), settleUpTo));
+}
+
+bool PostOffice::Pimpl::HandleReceivedMessage(AmqpConnection& connection, slaim::Message& msg, uint64_t deliveryTag)
+{
+    if (msg.m_type == activityRoutingKey) {
+        return false; // triggered activity
+    }
 
     if (recvBuffer.push_back(msg)) {
         recvThroughput.AddThroughput(msg.GetSize());
+        return true;
+    }
+    else if (recvBuffer.IsOverTypeQuota(msg)) {
+        // waiting here would stall the other types as well, which is what the quotas are for
+        ++recvOverQuotaDropCount;
+        if (receiverAcks) {
+            connection.Reject(deliveryTag, false);
+            rejectedDeliveryTags.push_back(deliveryTag);
+        }
+        std::lock_guard<std::mutex> lock(errorLogMutex);
+        errorLog.SetError("Receive quota of message type " + msg.GetType() + " full: dropping messages");
+        return false;
     }
     else {
         {
@@ -208,26 +369,49 @@ int PostOffice::Pimpl::HandleReceivedMessage(AMQPMessage* m)
         while (!killed) {
             if (recvBuffer.push_back(msg)) {
                 recvThroughput.AddThroughput(msg.GetSize());
-                break;
+                return true;
             }
             else {
+                // nothing is read from the connection meanwhile, so the broker would take it for dead
+                // after a couple of heartbeat intervals, and delete the queue with it
+                connection.SendHeartbeat();
                 std::this_thread::sleep_for(std::chrono::seconds(1)); // TODO: add a blocking push_back to the buffer itself
             }
         }
     }
-
-    return 0;
+    return false;
 }
 
 void PostOffice::Pimpl::RunSenderThread(const std::string& connectString)
 {
     bool error = false;
 
+    // Whenever the batch has been sent, up to SendBatchMaxMessages from the send buffer are
+    // moved into it at once, so the buffer's lock is taken once per batch however long the
+    // backlog is; when the whole buffer fits, it is swapped in, and as the batch is emptied
+    // before each swap, its allocation goes back to the buffer. Whatever is left of a batch
+    // when the connection fails is sent after reconnecting.
+    std::deque<slaim::Message> batch;
+
+    // With a spill queue, the messages are moved from the send buffer to the disk while the
+    // connection is down, so the buffer does not fill up. Once the connection is back, the
+    // spill queue is drained first, at a limited rate; meanwhile, new messages are appended
+    // to the spill queue as well, in order not to overtake the older ones.
+    double drainAllowance = 0.0;
+    auto lastDrainTime = std::chrono::steady_clock::now();
+
+    auto lastShrinkTime = std::chrono::steady_clock::now();
+
+    uint64_t drainedAcceptedCount = 0; // for Flush()
+
     while (!killed) {
         try {
-            AMQP amqp(connectString);
-            AMQPExchange* exchange = amqp.createExchange();
-            DeclareExchange(exchange);
+            AmqpConnection connection(connectString, 0);
+            connection.DeclareExchange(exchangeName, "topic", true);
+            senderConfirms = sendConfirmWindow > 0;
+            if (senderConfirms) {
+                connection.EnableConfirms();
+            }
 
             senderOk = true;
             if (error) {
@@ -246,30 +430,346 @@ void PostOffice::Pimpl::RunSenderThread(const std::string& connectString)
             double maxSecondsToWait = 0.0;
 
             while (!killed) {
-                slaim::Message msg;
-                if (sendBuffer.pop_front(msg, maxSecondsToWait)) {
-                    exchange->Publish(msg.m_text, msg.m_type);
-                    sendThroughput.AddThroughput(msg.GetSize());
+                if (activityPending.exchange(false)) { // before applying any changes it was set for
+                    PublishActivity(connection);
+                }
+
+                if (senderConfirms) {
+                    HandleConfirms(connection, 0.0);
+                }
+
+                const bool draining = IsDrainingSpillQueue();
+                if (batch.empty()) {
+                    // a batch at a time, as what is taken out of the send buffer no longer counts against its limits;
+                    // with unconfirmed messages, the confirms are read without much delay, too
+                    const size_t maxMessages = (std::max)(static_cast<size_t>(1), sendBatchMaxMessages.load());
+                    const uint64_t acceptedCount = sendAcceptedCount; // these are in the buffer already
+                    sendBuffer.drain_into(batch, draining || !unconfirmed.empty() || !republish.empty() ? (std::min)(maxSecondsToWait, 0.001) : maxSecondsToWait, maxMessages);
+                    if (batch.size() < maxMessages) {
+                        drainedAcceptedCount = acceptedCount; // the buffer was emptied
+                    }
+                    const unsigned int lingerMicroseconds = sendBatchLingerMicroseconds;
+                    if (lingerMicroseconds > 0 && !batch.empty() && batch.size() < maxMessages && !draining) {
+                        // let more messages come along, rather than wake up again for each one
+                        std::this_thread::sleep_for(std::chrono::microseconds(lingerMicroseconds));
+                        sendBuffer.drain_into(batch, 0, maxMessages - batch.size());
+                    }
+                }
+                if (draining) {
+                    const bool spilled = SpillBatch(batch);
+                    DrainSpillQueue(connection, drainAllowance, lastDrainTime);
+                    if (!spilled) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(10)); // until the draining makes room on the disk
+                    }
+                }
+                else {
+                    PublishBatch(connection, batch);
+                }
+                if (batch.empty() && republish.empty() && unconfirmed.empty() && !IsDrainingSpillQueue()) {
+                    sendSettledCount = drainedAcceptedCount;
                 }
 
                 const auto now = std::chrono::steady_clock::now();
                 if (now >= nextStatusMessageTime) {
                     slaim::Message statusMessage = GetStatusMessage();
-                    exchange->Publish(statusMessage.m_text, statusMessage.m_type);
+                    connection.Publish(exchangeName, statusMessage.m_type, statusMessage.m_text);
+                    if (spillQueue) {
+                        spillQueue->Flush();
+                    }
                     nextStatusMessageTime += std::chrono::seconds(1);
+                    const unsigned int shrinkSeconds = bufferShrinkSeconds;
+                    if (shrinkSeconds > 0 && now - lastShrinkTime >= std::chrono::seconds(shrinkSeconds)) {
+                        ShrinkAfterBurst(batch);
+                        lastShrinkTime = now;
+                    }
                     maxSecondsToWait = (std::max)(0.0, std::chrono::duration_cast<std::chrono::microseconds>(nextStatusMessageTime - now).count() * 1e-6);
                 }
             }
+
+            if (activityPending.exchange(false)) { // wake the receiver up to quit
+                PublishActivity(connection);
+            }
+
+            if (senderConfirms) {
+                WaitForConfirmsOnExit(connection);
+            }
         }
         catch (std::exception& e) {
             senderOk = false;
+            RequeueUnconfirmed();
             if (!error) {
                 error = true;
                 std::lock_guard<std::mutex> lock(errorLogMutex);
                 errorLog.SetError("Sender: " + std::string(e.what()));
             }
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+            if (spillQueue) {
+                SpillFor(1.0, batch);
+            }
+            else {
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+            }
+        }
+    }
+
+    KeepUnsentOnExit(batch);
+}
+
+bool PostOffice::Pimpl::IsDrainingSpillQueue() const
+{
+    return spillQueue && (spilledMessagePending || !spillQueue->IsEmpty());
+}
+
+bool PostOffice::Pimpl::SpillBatch(std::deque<slaim::Message>& batch)
+{
+    for (; !batch.empty(); batch.pop_front()) {
+        if (!spillQueue->Push(batch.front())) {
+            ReportSpillQueueErrors();
+            return false; // the rest stays in memory for now
+        }
+    }
+    return true;
+}
+
+void PostOffice::Pimpl::SpillFor(double seconds, std::deque<slaim::Message>& batch)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+    while (!killed) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        if (batch.empty()) {
+            sendBuffer.drain_into(batch, std::chrono::duration<double>(deadline - now).count(), (std::max)(static_cast<size_t>(1), sendBatchMaxMessages.load()));
+        }
+        if (!SpillBatch(batch)) {
+            std::this_thread::sleep_until(deadline); // no room on the disk either; the send buffer fills up now
+            break;
+        }
+    }
+    spillQueue->Flush();
+}
+
+void PostOffice::Pimpl::DrainSpillQueue(AmqpConnection& connection, double& drainAllowance, std::chrono::steady_clock::time_point& lastDrainTime)
+{
+    // a token bucket: bursts of at most a tenth of a second's worth of messages
+    const unsigned int messagesPerSecond = spillDrainMessagesPerSecond;
+    const size_t maxMessagesPerCall = 1024; // so that the status messages are not held up for long
+    const auto now = std::chrono::steady_clock::now();
+    if (messagesPerSecond > 0) {
+        const double maxAllowance = (std::max)(1.0, messagesPerSecond * 0.1);
+        drainAllowance = (std::min)(maxAllowance, drainAllowance + messagesPerSecond * std::chrono::duration<double>(now - lastDrainTime).count());
+    }
+    else {
+        drainAllowance = static_cast<double>(maxMessagesPerCall);
+    }
+    lastDrainTime = now;
+
+    for (size_t i = 0; i < maxMessagesPerCall && drainAllowance >= 1.0 && !killed; ++i) {
+        if (senderConfirms) {
+            WaitForConfirmWindow(connection);
+        }
+        const bool republishing = !republish.empty(); // older than anything in the spill queue
+        if (!republishing && !spilledMessagePending) {
+            if (!spillQueue->Pop(spilledMessage)) {
+                break; // drained
+            }
+            spilledMessagePending = true;
+        }
+        slaim::Message& msg = republishing ? republish.front() : spilledMessage;
+        const uint64_t sequenceNumber = connection.Publish(exchangeName, msg.m_type, msg.m_text);
+        sendThroughput.AddThroughput(msg.GetSize());
+        if (senderConfirms) {
+            KeepUntilConfirmed(sequenceNumber, msg);
+        }
+        if (republishing) {
+            republish.pop_front();
+        }
+        else {
+            spilledMessagePending = false;
+        }
+        drainAllowance -= 1.0;
+    }
+    ReportSpillQueueErrors();
+}
+
+// Oldest first, so that the next run picks the messages up in about the order they would have been sent.
+void PostOffice::Pimpl::KeepUnsentOnExit(std::deque<slaim::Message>& batch)
+{
+    RequeueUnconfirmed(); // the broker may have them, but that is not known
+    if (spillQueue) {
+        bool spilled = SpillBatch(republish) && SpillBatch(batch);
+        if (spilled && spilledMessagePending) {
+            spilled = spillQueue->Push(spilledMessage);
+            spilledMessagePending = !spilled;
+        }
+        if (spilled) {
+            sendBuffer.drain_into(batch, 0);
+            SpillBatch(batch);
+        }
+        spillQueue->Flush();
+        ReportSpillQueueErrors();
+    }
+
+    const size_t unsentCount = republish.size() + batch.size() + (spilledMessagePending ? 1 : 0) + sendBuffer.GetItemAndByteCount().first;
+    if (unsentCount > 0) {
+        std::ostringstream oss;
+        oss << "Sender: " << unsentCount << " messages were not sent, or not confirmed, before exiting";
+        std::lock_guard<std::mutex> lock(errorLogMutex);
+        errorLog.SetError(oss.str());
+    }
+}
+
+void PostOffice::Pimpl::ReportSpillQueueErrors()
+{
+    std::string error;
+    while (!(error = spillQueue->GetError()).empty()) {
+        std::lock_guard<std::mutex> lock(errorLogMutex);
+        errorLog.SetError("Spill queue: " + error);
+    }
+}
+
+void PostOffice::Pimpl::PublishActivity(AmqpConnection& connection)
+{
+    try {
+        connection.Publish(exchangeName, activityRoutingKey, "");
+    }
+    catch (std::exception&) {
+        activityPending = true; // to be published after reconnecting
+        throw;
+    }
+}
+
+// Publishes messages from the front of the batch, up to the batch limits (but at least one);
+// the ones to be republished go first.
+void PostOffice::Pimpl::PublishBatch(AmqpConnection& connection, std::deque<slaim::Message>& batch)
+{
+    const size_t maxMessages = sendBatchMaxMessages;
+    const size_t maxBytes = sendBatchMaxBytes;
+    size_t count = 0;
+    size_t byteCount = 0;
+    while ((!batch.empty() || !republish.empty()) && !killed && (count == 0 || (count < maxMessages && byteCount < maxBytes))) {
+        if (senderConfirms) {
+            WaitForConfirmWindow(connection);
+        }
+        std::deque<slaim::Message>& source = republish.empty() ? batch : republish;
+        slaim::Message& msg = source.front();
+        const uint64_t sequenceNumber = connection.Publish(exchangeName, msg.m_type, msg.m_text);
+        byteCount += msg.GetSize();
+        ++count;
+        if (senderConfirms) {
+            KeepUntilConfirmed(sequenceNumber, msg);
+        }
+        source.pop_front();
+    }
+    if (count > 0) {
+        sendThroughput.AddThroughput(byteCount, count); // once per batch: it takes a lock and reads the clock
+    }
+}
+
+void PostOffice::Pimpl::KeepUntilConfirmed(uint64_t sequenceNumber, slaim::Message& msg)
+{
+    UnconfirmedMessage unconfirmedMessage;
+    unconfirmedMessage.sequenceNumber = sequenceNumber;
+    unconfirmedMessage.msg = std::move(msg);
+    unconfirmedMessage.publishTime = std::chrono::steady_clock::now();
+    unconfirmed.push_back(std::move(unconfirmedMessage));
+}
+
+// Returns when the window has room for one more message.
+void PostOffice::Pimpl::WaitForConfirmWindow(AmqpConnection& connection)
+{
+    const double maxSecondsWithoutConfirms = 30.0; // then the connection is probably broken
+    const size_t window = (std::max)(static_cast<size_t>(1), sendConfirmWindow.load());
+    numcfc::TimeElapsed te;
+    while (unconfirmed.size() >= window && !killed) {
+        const size_t unconfirmedCount = unconfirmed.size();
+        HandleConfirms(connection, 0.1);
+        if (unconfirmed.size() < unconfirmedCount) {
+            te.ResetToCurrent();
         }
+        else if (te.GetElapsedSeconds() >= maxSecondsWithoutConfirms) {
+            throw std::runtime_error("No publisher confirms from the server in 30 seconds");
+        }
+    }
+}
+
+void PostOffice::Pimpl::HandleConfirms(AmqpConnection& connection, double maxSecondsToWait)
+{
+    uint64_t sequenceNumber = 0;
+    bool multiple = false;
+    bool ack = false;
+    while (connection.ReceiveConfirm(sequenceNumber, multiple, ack, maxSecondsToWait)) {
+        maxSecondsToWait = 0.0; // just handle the rest that have arrived already
+
+        // the status and activity messages have sequence numbers, too, but they are not kept
+        auto begin = unconfirmed.begin();
+        auto end = unconfirmed.begin();
+        while (end != unconfirmed.end() && end->sequenceNumber <= sequenceNumber) {
+            if (!multiple && end->sequenceNumber < sequenceNumber) {
+                ++begin;
+            }
+            ++end;
+        }
+        if (begin == end) {
+            continue;
+        }
+
+        if (ack) {
+            const auto now = std::chrono::steady_clock::now();
+            for (auto i = begin; i != end; ++i) {
+                const double latency = std::chrono::duration<double>(now - i->publishTime).count();
+                confirmLatencySum += latency;
+                confirmLatencyMax = (std::max)(confirmLatencyMax, latency);
+            }
+            confirmCount += end - begin;
+        }
+        else {
+            // to be published again, before anything else
+            nackCount += end - begin;
+            for (auto i = end; i != begin; --i) {
+                republish.push_front(std::move((i - 1)->msg));
+            }
+        }
+        unconfirmed.erase(begin, end);
+    }
+}
+
+// Gives the broker a moment to confirm what has been published, so that less is left to be spilled or lost.
+void PostOffice::Pimpl::WaitForConfirmsOnExit(AmqpConnection& connection)
+{
+    const double maxSecondsToWait = 5.0;
+    numcfc::TimeElapsed te;
+    while (!unconfirmed.empty()) {
+        const double secondsLeft = maxSecondsToWait - te.GetElapsedSeconds();
+        if (secondsLeft <= 0.0) {
+            break;
+        }
+        HandleConfirms(connection, (std::min)(secondsLeft, 0.1));
+    }
+}
+
+void PostOffice::Pimpl::RequeueUnconfirmed()
+{
+    republishCount += unconfirmed.size();
+    for (auto i = unconfirmed.rbegin(); i != unconfirmed.rend(); ++i) {
+        republish.push_front(std::move(i->msg));
+    }
+    unconfirmed.clear();
+}
+
+void PostOffice::Pimpl::ShrinkAfterBurst(std::deque<slaim::Message>& batch)
+{
+    const size_t lowItemCount = 1024;
+    const bool recvShrunk = recvBuffer.ShrinkAfterBurst(lowItemCount);
+    const bool sendShrunk = sendBuffer.ShrinkAfterBurst(lowItemCount);
+    if (!recvShrunk && !sendShrunk) {
+        return;
+    }
+    if (batch.empty()) {
+        std::deque<slaim::Message>().swap(batch); // it may have been the buffer's storage during the burst
+    }
+    if (trimHeapAfterBurst) {
+        TrimHeap(); // the heap may keep what the burst freed
     }
 }
 
@@ -300,12 +800,10 @@ slaim::Message PostOffice::Pimpl::GetStatusMessage() { // can be called from the
     amsg.m_attributes["username"] = username;
     amsg.m_attributes["postoffice_version"] = GetVersion();
 
+    // (in the lock-free modes, the item and byte counts are not necessarily in sync)
     std::pair<size_t, size_t> recvBufferSize = recvBuffer.GetItemAndByteCount();
     std::pair<size_t, size_t> sendBufferSize = sendBuffer.GetItemAndByteCount();
 
-    assert((recvBufferSize.first > 0) == (recvBufferSize.second > 0));
-    assert((sendBufferSize.first > 0) == (sendBufferSize.second > 0));
-
     {
         std::ostringstream oss;
         oss << recvBufferSize.first;
@@ -316,6 +814,11 @@ slaim::Message PostOffice::Pimpl::GetStatusMessage() { // can be called from the
         oss << recvBufferSize.second;
         amsg.m_attributes["recv_buf_byte_count"] = oss.str();
     }
+    {
+        std::ostringstream oss;
+        oss << recvBuffer.GetAllocatedByteCount();
+        amsg.m_attributes["recv_buf_allocated_byte_count"] = oss.str();
+    }
     {
         std::ostringstream oss;
         oss << sendBufferSize.first;
@@ -326,6 +829,51 @@ slaim::Message PostOffice::Pimpl::GetStatusMessage() { // can be called from the
         oss << sendBufferSize.second;
         amsg.m_attributes["send_buf_byte_count"] = oss.str();
     }
+    {
+        std::ostringstream oss;
+        oss << sendBuffer.GetAllocatedByteCount();
+        amsg.m_attributes["send_buf_allocated_byte_count"] = oss.str();
+    }
+    {
+        std::ostringstream oss;
+        oss << recvOverQuotaDropCount;
+        amsg.m_attributes["recv_over_quota_drop_count"] = oss.str();
+    }
+    if (spillQueue) {
+        std::ostringstream oss;
+        oss << spillQueue->GetByteCount();
+        amsg.m_attributes["send_spill_byte_count"] = oss.str();
+    }
+    if (senderConfirms) {
+        {
+            std::ostringstream oss;
+            oss << unconfirmed.size() << "/" << sendConfirmWindow;
+            amsg.m_attributes["send_confirm_window_occupancy"] = oss.str();
+        }
+        {
+            std::ostringstream oss;
+            oss << (confirmCount > 0 ? confirmLatencySum / confirmCount * 1e3 : 0.0);
+            amsg.m_attributes["send_confirm_latency_avg_ms"] = oss.str();
+        }
+        {
+            std::ostringstream oss;
+            oss << confirmLatencyMax * 1e3;
+            amsg.m_attributes["send_confirm_latency_max_ms"] = oss.str();
+        }
+        {
+            std::ostringstream oss;
+            oss << nackCount;
+            amsg.m_attributes["send_nack_count"] = oss.str();
+        }
+        {
+            std::ostringstream oss;
+            oss << republishCount;
+            amsg.m_attributes["send_republish_count"] = oss.str();
+        }
+        confirmCount = 0; // the latencies are per status message
+        confirmLatencySum = 0.0;
+        confirmLatencyMax = 0.0;
+    }
 
     // collect also some stats on sent/received msgs/bytes per sec (given a 10-sec window)
     std::pair<double, double> recvThroughputPerSec = recvThroughput.GetThroughputPerSec();
@@ -361,10 +909,101 @@ slaim::Message PostOffice::Pimpl::GetStatusMessage() { // can be called from the
     return amsg.GetRawMessage();
 }
 
+bool PostOffice::Pimpl::ParseBufferMode(const std::string& text, const char* bufferName, LimitedSizeBuffer<slaim::Message>::Mode& mode)
+{
+    if (LimitedSizeBuffer<slaim::Message>::ParseMode(text, mode)) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(errorLogMutex);
+    errorLog.SetError("Unknown " + std::string(bufferName) + " buffer mode: " + text);
+    return false;
+}
+
+void PostOffice::Pimpl::SetReceiveTypeQuotas(const std::string& text)
+{
+    std::istringstream iss(text);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        const size_t begin = item.find_first_not_of(" \t");
+        if (begin == std::string::npos) {
+            continue;
+        }
+        const size_t equals = item.find('=');
+        size_t maxItemCount = 0;
+        double maxMegabytes = 0;
+        unsigned int weight = 1;
+        bool valid = false;
+        if (equals != std::string::npos) {
+            // items/megabytes, then an optional /weight, and nothing else
+            const char* quota = item.c_str() + equals + 1;
+            int consumed = 0;
+            valid = sscanf(quota, "%zu/%lf%n", &maxItemCount, &maxMegabytes, &consumed) == 2;
+            if (valid && quota[consumed] == '/') {
+                quota += consumed;
+                consumed = 0;
+                valid = sscanf(quota, "/%u%n", &weight, &consumed) == 1;
+            }
+            valid = valid && quota[consumed + strspn(quota + consumed, " \t")] == '\0';
+        }
+        if (!valid) {
+            std::lock_guard<std::mutex> lock(errorLogMutex);
+            errorLog.SetError("Invalid receive type quota: " + item);
+            continue;
+        }
+        const size_t end = item.find_last_not_of(" \t", equals - 1);
+        const std::string type = end == std::string::npos || end < begin ? std::string() : item.substr(begin, end + 1 - begin);
+        recvBuffer.SetTypeQuota(type, maxItemCount, static_cast<size_t>(maxMegabytes * 1024 * 1024), weight);
+    }
+}
+
 PostOffice::PostOffice(const std::string& connectString, const char* clientIdentifier)
     : connectString(connectString)
 {
 	pimpl_ = new Pimpl(clientIdentifier);
+    StartThreads();
+}
+
+PostOffice::PostOffice(const std::string& connectString, const char* clientIdentifier, claim::PostOfficeInitializer& initializer)
+    : connectString(connectString)
+{
+    pimpl_ = new Pimpl(clientIdentifier);
+
+    ReadSettings(initializer); // the limits first: in the lock-free modes, they determine the capacity
+
+    const bool limitAllocatedBytes = initializer.GetBufferLimitsAllocatedBytes();
+    pimpl_->recvBuffer.SetLimitAllocatedBytes(limitAllocatedBytes);
+    pimpl_->sendBuffer.SetLimitAllocatedBytes(limitAllocatedBytes);
+
+    LimitedSizeBuffer<slaim::Message>::Mode mode;
+    if (pimpl_->ParseBufferMode(initializer.GetReceiveBufferMode(), "receive", mode)) {
+        pimpl_->recvBuffer.SetMode(mode);
+    }
+    if (pimpl_->ParseBufferMode(initializer.GetSendBufferMode(), "send", mode)) {
+        pimpl_->sendBuffer.SetMode(mode);
+    }
+
+    const std::string spillDirectory = initializer.GetSendSpillDirectory();
+    if (!spillDirectory.empty()) {
+        claim::RecordingSegmentSettings spillSettings;
+        spillSettings.directory = spillDirectory;
+        spillSettings.prefix = "spill";
+        spillSettings.maxSegmentBytes = 64 * 1024 * 1024;
+        spillSettings.maxSegmentSeconds = 0;
+        spillSettings.maxTotalBytes = static_cast<uint64_t>(initializer.GetSendSpillMaxMegabytes() * 1024 * 1024);
+        try {
+            pimpl_->spillQueue.reset(new claim::SpillQueue(spillSettings));
+        }
+        catch (std::exception& e) {
+            std::lock_guard<std::mutex> lock(pimpl_->errorLogMutex);
+            pimpl_->errorLog.SetError("Spill queue: " + std::string(e.what()));
+        }
+    }
+
+    StartThreads();
+}
+
+void PostOffice::StartThreads()
+{
     pimpl_->receiver = std::thread(&Pimpl::RunReceiverThread, pimpl_, connectString);
     pimpl_->sender = std::thread(&Pimpl::RunSenderThread, pimpl_, connectString);
 }
@@ -373,16 +1012,8 @@ PostOffice::~PostOffice()
 {
     pimpl_->killed = true;
     Activity();
-
-    {
-        std::lock_guard<std::mutex> lock(pimpl_->activityFuturesMutex);
-        while (!pimpl_->activityFutures.empty()) {
-            pimpl_->activityFutures.pop_front();
-        }
-    }
-
-    pimpl_->receiver.join();
     pimpl_->sender.join();
+    pimpl_->receiver.join(); // notices within receiverPollMilliseconds
     delete pimpl_;
 }
 
@@ -421,13 +1052,34 @@ void PostOffice::Unsubscribe(const MessageType& type)
 
 bool PostOffice::Receive(Message& msg, double maxSecondsToWait)
 {
-    return pimpl_->recvBuffer.pop_front(msg, maxSecondsToWait);
+    if (!pimpl_->recvBuffer.pop_front(msg, maxSecondsToWait)) {
+        return false;
+    }
+    ++pimpl_->recvDequeuedCount;
+    return true;
+}
+
+size_t PostOffice::ReceiveBatch(std::vector<Message>& msgs, size_t maxCount, double maxSecondsToWait)
+{
+    const size_t count = pimpl_->recvBuffer.pop_front_many(msgs, maxCount, maxSecondsToWait);
+    pimpl_->recvDequeuedCount += count;
+    return count;
+}
+
+size_t PostOffice::ReceiveAll(std::deque<Message>& msgs, double maxSecondsToWait)
+{
+    const size_t count = pimpl_->recvBuffer.drain_into(msgs, maxSecondsToWait);
+    pimpl_->recvDequeuedCount += count;
+    return count;
 }
 
 bool PostOffice::Send(const Message& msg)
 {
     bool retVal = pimpl_->sendBuffer.push_back(msg);
-    if (!retVal) {
+    if (retVal) {
+        ++pimpl_->sendAcceptedCount;
+    }
+    else {
         std::pair<size_t, size_t> bufferSize = pimpl_->sendBuffer.GetItemAndByteCount();
         std::ostringstream oss;
         oss << "Unable to push to the messages being sent buffer! Buffer full? (Message type = " << msg.GetType() << "; the buffer currently has " << bufferSize.first << " items totaling " << (bufferSize.second / (1024.0 * 1024.0)) << " MB.)";
@@ -438,36 +1090,38 @@ bool PostOffice::Send(const Message& msg)
     return retVal;
 }
 
-void PostOffice::Activity()
+size_t PostOffice::SendBatch(const std::vector<Message>& msgs, size_t first)
 {
-    {
-        std::lock_guard<std::mutex> lock(pimpl_->activityFuturesMutex);
-        for (auto i = pimpl_->activityFutures.begin(), end = pimpl_->activityFutures.end(); i != end; ) {
-            if (i->wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
-                i = pimpl_->activityFutures.erase(i);
-                end = pimpl_->activityFutures.end();
-            }
-            else {
-                ++i;
-            }
-        }
+    const size_t count = pimpl_->sendBuffer.push_back_many(msgs, first);
+    pimpl_->sendAcceptedCount += count;
+    if (first + count < msgs.size()) {
+        std::pair<size_t, size_t> bufferSize = pimpl_->sendBuffer.GetItemAndByteCount();
+        std::ostringstream oss;
+        oss << "Unable to push " << (msgs.size() - first - count) << " of " << (msgs.size() - first) << " messages to the messages being sent buffer! Buffer full? (The buffer currently has " << bufferSize.first << " items totaling " << (bufferSize.second / (1024.0 * 1024.0)) << " MB.)";
+
+        std::lock_guard<std::mutex> lock(pimpl_->errorLogMutex);
+        pimpl_->errorLog.SetError(oss.str());
     }
+    return count;
+}
 
-    auto handle = std::async(std::launch::async, [this]() {
-        try {
-            AMQP amqp(connectString);
-            AMQPExchange* exchange = amqp.createExchange();
-            DeclareExchange(exchange);
-            exchange->Publish("", pimpl_->activityRoutingKey);
-        }
-        catch (std::exception& e) {
-            std::lock_guard<std::mutex> lock(pimpl_->errorLogMutex);
-            pimpl_->errorLog.SetError(e.what());
+bool PostOffice::Flush(double maxSecondsToWait)
+{
+    const uint64_t acceptedCount = pimpl_->sendAcceptedCount;
+    numcfc::TimeElapsed te;
+    while (pimpl_->sendSettledCount < acceptedCount) {
+        if (te.GetElapsedSeconds() >= maxSecondsToWait) {
+            return false;
         }
-    });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
 
-    std::lock_guard<std::mutex> lock(pimpl_->activityFuturesMutex);
-    pimpl_->activityFutures.push_back(std::move(handle));
+void PostOffice::Activity()
+{
+    pimpl_->activityPending = true;
+    pimpl_->sendBuffer.interrupt_wait();
 }
 
 std::string PostOffice::GetError()
@@ -492,6 +1146,44 @@ void PostOffice::ReadSettings(claim::PostOfficeInitializer& initializer)
     pimpl_->recvBuffer.SetMaxByteCount(static_cast<size_t>(recvBufferMaxMegabytes * 1024 * 1024));
     pimpl_->sendBuffer.SetMaxItemCount(sendBufferMaxItemCount);
     pimpl_->sendBuffer.SetMaxByteCount(static_cast<size_t>(sendBufferMaxMegabytes * 1024 * 1024));
+    pimpl_->recvBuffer.SetSpinMicroseconds(initializer.GetReceiveBufferSpinMicroseconds());
+
+    const size_t recvBufferMaxItemCountPerType = initializer.GetReceiveBufferMaxItemCountPerType();
+    LimitedSizeBuffer<slaim::Message>::Mode recvBufferMode;
+    if (recvBufferMaxItemCountPerType > 0 && LimitedSizeBuffer<slaim::Message>::ParseMode(initializer.GetReceiveBufferMode(), recvBufferMode)
+        && recvBufferMode != LimitedSizeBuffer<slaim::Message>::Locked) {
+        std::lock_guard<std::mutex> lock(pimpl_->errorLogMutex);
+        pimpl_->errorLog.SetError("The per-type receive quotas are available in the locked receive buffer mode only");
+    }
+    else {
+        pimpl_->SetReceiveTypeQuotas(initializer.GetReceiveBufferTypeQuotas());
+        pimpl_->recvBuffer.SetDefaultTypeQuota(recvBufferMaxItemCountPerType, static_cast<size_t>(initializer.GetReceiveBufferMaxMegabytesPerType() * 1024 * 1024));
+    }
+    pimpl_->sendBuffer.SetSpinMicroseconds(initializer.GetSendBufferSpinMicroseconds());
+    pimpl_->sendBatchMaxMessages = initializer.GetSendBatchMaxMessages();
+    pimpl_->sendBatchMaxBytes = static_cast<size_t>(initializer.GetSendBatchMaxMegabytes() * 1024 * 1024);
+    pimpl_->sendBatchLingerMicroseconds = initializer.GetSendBatchLingerMicroseconds();
+    pimpl_->sendConfirmWindow = initializer.GetSendConfirmWindow();
+    pimpl_->recvPrefetchCount = initializer.GetReceivePrefetchCount();
+    pimpl_->receiverPollMilliseconds = initializer.GetReceiverPollMilliseconds();
+    pimpl_->receiverHeartbeatSeconds = initializer.GetReceiverHeartbeatSeconds();
+    pimpl_->spillDrainMessagesPerSecond = initializer.GetSendSpillDrainMessagesPerSecond();
+    pimpl_->bufferShrinkSeconds = initializer.GetBufferShrinkSeconds();
+    pimpl_->trimHeapAfterBurst = initializer.GetTrimHeapAfterBurst();
+
+    if (pimpl_->sender.joinable()) { // already running
+        LimitedSizeBuffer<slaim::Message>::Mode recvBufferMode, sendBufferMode;
+        if (pimpl_->ParseBufferMode(initializer.GetReceiveBufferMode(), "receive", recvBufferMode)
+            && pimpl_->ParseBufferMode(initializer.GetSendBufferMode(), "send", sendBufferMode)
+            && (recvBufferMode != pimpl_->recvBuffer.GetMode() || sendBufferMode != pimpl_->sendBuffer.GetMode())) {
+            std::lock_guard<std::mutex> lock(pimpl_->errorLogMutex);
+            pimpl_->errorLog.SetError("The buffer modes can be changed only when constructing the post office");
+        }
+        if (initializer.GetBufferLimitsAllocatedBytes() != pimpl_->recvBuffer.GetLimitAllocatedBytes()) {
+            std::lock_guard<std::mutex> lock(pimpl_->errorLogMutex);
+            pimpl_->errorLog.SetError("BufferLimitsAllocatedBytes can be changed only when constructing the post office");
+        }
+    }
 }
 
 }
@@ -23,6 +23,10 @@ class PostOffice
 {
 public:
 	PostOffice(const std::string& connectString, const char* clientIdentifier);
+
+	// Reads the settings before starting the threads, so that also the buffer modes can be applied.
+	PostOffice(const std::string& connectString, const char* clientIdentifier, claim::PostOfficeInitializer& initializer);
+
 	virtual ~PostOffice();
 
     virtual void Subscribe(const slaim::MessageType& t) override;
@@ -30,9 +34,22 @@ public:
 
     virtual bool Send(const slaim::Message& msg) override;
 
+    // Takes the buffer lock only once for the whole batch.
+    virtual size_t SendBatch(const std::vector<slaim::Message>& msgs, size_t first = 0) override;
+
+    // Waits until the sender thread has published everything accepted so far (and, with
+    // confirms, had it confirmed), including whatever is in the spill queue.
+    virtual bool Flush(double maxSecondsToWait) override;
+
 	// If the return value is true, then a complete message was received.
 	virtual bool Receive(slaim::Message& msg, double maxSecondsToWait = 0) override;
 
+    // Takes the buffer lock only once for the whole batch.
+    virtual size_t ReceiveBatch(std::vector<slaim::Message>& msgs, size_t maxCount, double maxSecondsToWait = 0) override;
+
+    // Takes the buffer lock only once, and swaps the whole buffer out if msgs is empty.
+    virtual size_t ReceiveAll(std::deque<slaim::Message>& msgs, double maxSecondsToWait = 0) override;
+
     bool IsOk() const; // probably not really needed
 
     virtual const char* GetVersion() const override;
@@ -41,9 +58,12 @@ public:
 
     virtual std::string GetClientAddress() const override;
 
+    // The buffer modes can be changed only using the constructor.
     void ReadSettings(claim::PostOfficeInitializer& initializer);
 
 private:
+    void StartThreads();
+
     // May be called from any thread.
     virtual void Activity();
 
@@ -29,7 +29,11 @@ public:
 	void SetText(const std::string& text);
 	void SetText(const char* p, size_t len);
 
-	size_t GetSize() const;
+	size_t GetSize() const; // the length of the type and the text
+
+	//! Roughly, the memory taken by the message: the object itself, and the heap blocks
+	//! of the strings (including unused capacity, and the typical overhead of the heap).
+	size_t GetAllocatedSize() const;
 
 	MessageType m_type; // moving to getters and setters...:
 	std::string m_text; // please don't write new code that would access these directly!
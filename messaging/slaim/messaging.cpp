@@ -170,6 +170,25 @@ size_t Message::GetSize() const
 	return m_type.length() + m_text.length();
 }
 
+namespace {
+	// Typical heaps keep a header of one word per block, and round blocks up to 16 bytes.
+	size_t GetHeapBlockSize(size_t size)
+	{
+		return (size + sizeof(void*) + 15) & ~static_cast<size_t>(15);
+	}
+
+	size_t GetHeapSize(const std::string& s)
+	{
+		static const size_t localCapacity = std::string().capacity(); // short strings are stored in the object itself
+		return s.capacity() > localCapacity ? GetHeapBlockSize(s.capacity() + 1) : 0;
+	}
+}
+
+size_t Message::GetAllocatedSize() const
+{
+	return sizeof(Message) + GetHeapSize(m_type) + GetHeapSize(m_text);
+}
+
 
 Buffer::~Buffer()
 {
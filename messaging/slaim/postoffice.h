@@ -12,6 +12,8 @@
 #include <string>
 #include <set>
 #include <map>
+#include <vector>
+#include <deque>
 
 #include "errorlog.h"
 #include "message.h"
@@ -63,6 +65,33 @@ public:
 	*/
 	virtual bool Send(const Message& msg) = 0;
 
+	//! Send a number of messages at once.
+	/*! The default implementation simply calls Send() repeatedly, but implementations
+		are encouraged to override this with something more efficient.
+		\param msgs The messages to send, in order.
+		\param first The index of the first message to send.
+		\return The number of messages accepted. If this is less than requested, then the rest
+				were not sent (typically because a buffer is full); the caller may retry later,
+				starting from where this call stopped.
+	*/
+	virtual size_t SendBatch(const std::vector<Message>& msgs, size_t first = 0) {
+		size_t count = 0;
+		for (size_t i = first, end = msgs.size(); i < end && Send(msgs[i]); ++i) {
+			++count;
+		}
+		return count;
+	}
+
+	//! Wait until the messages accepted by Send() and SendBatch() so far have been sent.
+	/*! Useful e.g. before exiting, as the messages may still be buffered. The default
+		implementation returns right away, which suits implementations that do not buffer.
+		\param maxSecondsToWait The maximum time in seconds to wait.
+		\return True if the messages were sent, false if the time ran out first.
+	*/
+	virtual bool Flush(double /*maxSecondsToWait*/) {
+		return true;
+	}
+
 	//! Try to receive a message.
 	/*! \param msg The received message is copied to this object.
 		\param maxSecondsToWait The maximum time in seconds to wait for activity.
@@ -70,6 +99,42 @@ public:
 	*/
 	virtual bool Receive(Message& msg, double maxSecondsToWait = 0) = 0;
 
+	//! Try to receive a number of messages at once.
+	/*! The default implementation simply calls Receive() repeatedly, but implementations
+		are encouraged to override this with something more efficient.
+		\param msgs The received messages are appended to this vector.
+		\param maxCount The maximum number of messages to receive.
+		\param maxSecondsToWait The maximum time in seconds to wait for the first message.
+		\return The number of messages received.
+	*/
+	virtual size_t ReceiveBatch(std::vector<Message>& msgs, size_t maxCount, double maxSecondsToWait = 0) {
+		size_t count = 0;
+		Message msg;
+		while (count < maxCount && Receive(msg, count == 0 ? maxSecondsToWait : 0)) {
+			msgs.push_back(msg);
+			++count;
+		}
+		return count;
+	}
+
+	//! Try to receive all the messages that are available at once.
+	/*! The default implementation simply calls Receive() repeatedly, but implementations
+		are encouraged to override this with something more efficient.
+		\param msgs The received messages are appended to this deque. Passing the same
+		            (emptied) deque each time lets implementations recycle its allocation.
+		\param maxSecondsToWait The maximum time in seconds to wait for the first message.
+		\return The number of messages received.
+	*/
+	virtual size_t ReceiveAll(std::deque<Message>& msgs, double maxSecondsToWait = 0) {
+		size_t count = 0;
+		Message msg;
+		while (Receive(msg, count == 0 ? maxSecondsToWait : 0)) {
+			msgs.push_back(msg);
+			++count;
+		}
+		return count;
+	}
+
 	//! Get the address identifying the client. 
 	virtual std::string GetClientAddress() const = 0;
 
@@ -0,0 +1,118 @@
+//               Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// Measures the producer-to-consumer handoff latency of LimitedSizeBuffer: the time from
+// just before push_back until pop_front returns the item in the consumer thread, which
+// is waiting for it.
+//
+// Usage: buffer-latency [message count] [interval in microseconds] [spin microseconds]
+//
+// Without the spin time, both no spin and a spin time of 100 us are measured. Each
+// mode (locked, spsc, mpsc) is measured in turn.
+
+#include <messaging/numrabw/LimitedSizeBuffer.h>
+#include <messaging/slaim/message.h>
+#include <numcfc/Logger.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef LimitedSizeBuffer<slaim::Message> Buffer;
+
+void Measure(Buffer::Mode mode, const char* modeName, unsigned int spinMicroseconds, size_t messageCount, unsigned int intervalMicroseconds)
+{
+    Buffer buffer;
+    buffer.SetMaxItemCount(1024);
+    buffer.SetMode(mode);
+    buffer.SetSpinMicroseconds(spinMicroseconds);
+
+    // the producer writes the push time of each message before pushing it, and the
+    // consumer reads it only after popping the message, so no other synchronization is needed
+    std::vector<std::chrono::steady_clock::time_point> pushTimes(messageCount);
+    std::vector<double> latencies(messageCount);
+
+    std::thread consumer([&] {
+        slaim::Message msg;
+        for (size_t i = 0; i < messageCount; ) {
+            if (buffer.pop_front(msg, 1.0)) {
+                const auto popTime = std::chrono::steady_clock::now();
+                const size_t index = static_cast<size_t>(strtoull(msg.m_text.c_str(), NULL, 10));
+                latencies[index] = std::chrono::duration<double, std::micro>(popTime - pushTimes[index]).count();
+                ++i;
+            }
+        }
+    });
+
+    slaim::Message msg;
+    msg.m_type = "buffer-latency";
+    auto nextPushTime = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < messageCount; ++i) {
+        nextPushTime += std::chrono::microseconds(intervalMicroseconds);
+        while (std::chrono::steady_clock::now() < nextPushTime) {
+            ; // busy-wait, in order not to add the producer's own wakeup latency to the schedule
+        }
+        msg.m_text = std::to_string(i);
+        pushTimes[i] = std::chrono::steady_clock::now();
+        while (!buffer.push_back(msg)) {
+            std::this_thread::yield();
+        }
+    }
+
+    consumer.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        return latencies[(std::min)(latencies.size() - 1, static_cast<size_t>(p / 100.0 * latencies.size()))];
+    };
+
+    std::ostringstream oss;
+    oss.precision(1);
+    oss << std::fixed << modeName << ", spin " << spinMicroseconds << " us: p50 = " << percentile(50) << " us, p99 = " << percentile(99)
+        << " us, p99.9 = " << percentile(99.9) << " us, max = " << latencies.back() << " us";
+    numcfc::Logger::LogAndEcho(oss.str(), "buffer-latency");
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t messageCount = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 100000;
+    const unsigned int intervalMicroseconds = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 20;
+
+    std::vector<unsigned int> spinMicroseconds;
+    if (argc > 3) {
+        spinMicroseconds.push_back(static_cast<unsigned int>(atoi(argv[3])));
+    }
+    else {
+        spinMicroseconds.push_back(0);
+        spinMicroseconds.push_back(100);
+    }
+
+    if (messageCount == 0) {
+        numcfc::Logger::LogAndEcho("Nothing to measure", "error");
+        return 1;
+    }
+
+    {
+        std::ostringstream oss;
+        oss << "Measuring the handoff latency of " << messageCount << " messages, one every " << intervalMicroseconds << " us";
+        numcfc::Logger::LogAndEcho(oss.str(), "buffer-latency");
+    }
+
+    for (size_t i = 0; i < spinMicroseconds.size(); ++i) {
+        Measure(Buffer::Locked, "locked", spinMicroseconds[i], messageCount, intervalMicroseconds);
+        Measure(Buffer::SingleProducerSingleConsumer, "spsc  ", spinMicroseconds[i], messageCount, intervalMicroseconds);
+        Measure(Buffer::MultipleProducersSingleConsumer, "mpsc  ", spinMicroseconds[i], messageCount, intervalMicroseconds);
+    }
+
+    return 0;
+}
@@ -6,6 +6,8 @@
 
 #include <messaging/claim/PostOffice.h>
 #include <messaging/claim/AttributeMessage.h>
+#include <messaging/claim/AttributeMessageDelta.h>
+#include <messaging/claim/InfluxLineProtocol.h>
 #include <numcfc/Logger.h>
 #include <numcfc/Time.h>
 #include <numcfc/IdGenerator.h>
@@ -31,6 +33,9 @@ int main()
     claim::PostOffice postOffice;
     postOffice.Initialize(iniFile, "dsl");
 
+    const bool deltaEncoding = iniFile.GetSetValue("DiskSpaceLogger", "DeltaEncoding", 0, "Send only changed values, plus a full keyframe every now and then (receivers need to use claim::AttributeMessageDeltaDecoder)") > 0;
+    claim::AttributeMessageDeltaEncoder deltaEncoder;
+
     if (iniFile.IsDirty()) {
         numcfc::Logger::LogAndEcho("Saving the ini file...");
         iniFile.Save();
@@ -44,6 +49,7 @@ int main()
 
         claim::AttributeMessage amsg;
         amsg.m_type = "influx-output";
+        amsg.m_attributes[claim::InfluxLineProtocolWriter::defaultTimestampAttribute] = std::to_string(claim::InfluxLineProtocolWriter::GetCurrentTimeNanoseconds());
 
         const std::string hostname = numcfc::GetHostname();
 
@@ -72,6 +78,11 @@ int main()
         amsg.m_attributes["freeBytes_GB,hostname=" + hostname] = oss.str();
 #endif // _WIN32
 
-        postOffice.Send(amsg);
+        if (deltaEncoding) {
+            postOffice.Send(deltaEncoder.Encode(amsg));
+        }
+        else {
+            postOffice.Send(amsg);
+        }
     }
 }
\ No newline at end of file
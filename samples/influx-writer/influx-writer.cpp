@@ -6,13 +6,13 @@
 
 #include <messaging/claim/PostOffice.h>
 #include <messaging/claim/AttributeMessage.h>
+#include <messaging/claim/AttributeMessageDelta.h>
+#include <messaging/claim/InfluxLineProtocol.h>
 #include <numcfc/Logger.h>
 #include <numcfc/Time.h>
 
 #include <curl/curl.h>
 
-#include <unordered_map>
-
 int main()
 {
 	numcfc::Logger::LogAndEcho("influx-writer starting - initializing...");
@@ -44,6 +44,10 @@ int main()
 
     const bool debugMode = iniFile.GetSetValue("InfluxWriter", "DebugMode", 0) > 0;
 
+    const bool keepAllPoints = iniFile.GetSetValue("InfluxWriter", "KeepAllPoints", 0, "If set, write every point received; otherwise, write only the last value of each series per request") > 0;
+
+    const size_t maxPointsPerRequest = static_cast<size_t>(iniFile.GetSetValue("InfluxWriter", "MaxPointsPerRequest", 5000, "Maximum number of points to write in a single request"));
+
     numcfc::Logger::LogAndEcho("Writing to: " + url + " : " + db);
 
     if (iniFile.IsDirty()) {
@@ -106,31 +110,33 @@ int main()
     // write data
     curl_easy_setopt(curl, CURLOPT_URL, (url + "write?db=" + db + authentication2).c_str());
 
+    claim::AttributeMessageDeltaDecoder deltaDecoder;
+
+    claim::InfluxLineProtocolWriter lineProtocolWriter;
+    lineProtocolWriter.SetKeepAllPoints(keepAllPoints);
+
     while (true) {
-        std::unordered_map<std::string, std::string> valuesToWrite;
         slaim::Message msg;
 
-        const auto timeout = [&valuesToWrite]() {
-            return valuesToWrite.empty() ? 1.0 : 0.0;
+        const auto timeout = [&lineProtocolWriter]() {
+            return lineProtocolWriter.IsEmpty() ? 1.0 : 0.0;
         };
  
-        while (postOffice.Receive(msg, timeout())) {
+        while (lineProtocolWriter.GetPointCount() < maxPointsPerRequest && postOffice.Receive(msg, timeout())) {
             if (msg.GetType() == "influx-output") {
-                claim::AttributeMessage amsg(msg);
-                for (const auto& attribute : amsg.m_attributes) {
-                    valuesToWrite[attribute.first] = attribute.second;
+                claim::AttributeMessage amsg;
+                if (!deltaDecoder.Decode(msg, amsg)) {
+                    continue; // a delta without a base: wait for the next keyframe
                 }
+                lineProtocolWriter.Add(amsg);
             }
         }
 
-        if (!valuesToWrite.empty()) {
-            std::string write;
-            
-            for (const auto& valueToWrite : valuesToWrite) {
-                write += valueToWrite.first + " value=" + valueToWrite.second + "\n";
-                if (debugMode) {
-                    numcfc::Logger::LogAndEcho(valueToWrite.first + " = " + valueToWrite.second, "log_debug");
-                }
+        if (!lineProtocolWriter.IsEmpty()) {
+            const std::string& write = lineProtocolWriter.GetBody();
+
+            if (debugMode) {
+                numcfc::Logger::LogAndEcho(write, "log_debug");
             }
 
             curl_easy_setopt(curl, CURLOPT_POSTFIELDS, write.c_str());
@@ -140,6 +146,8 @@ int main()
             if (result != CURLE_OK) {
                 numcfc::Logger::LogAndEcho("Writing data failed: " + std::string(curl_easy_strerror(result)), "log_error");
             }
+
+            lineProtocolWriter.Clear();
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,153 @@
+//               Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// Measures the sustained write (and read) throughput of the recording format,
+// compared to the legacy WriteMessageToStream format.
+//
+// Usage: recording-benchmark [filename] [message count] [message size in bytes]
+
+#include <messaging/claim/MessageRecording.h>
+#include <messaging/claim/AsyncRecordingWriter.h>
+#include <messaging/claim/MappedRecording.h>
+#include <messaging/claim/MessageStreaming.h>
+#include <numcfc/Logger.h>
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+void Report(const char* what, size_t messageCount, double totalBytes, double seconds)
+{
+    std::ostringstream oss;
+    oss << what << ": " << messageCount << " messages in " << seconds << " s = "
+        << messageCount / seconds << " msgs/s, " << totalBytes / seconds / (1024.0 * 1024.0) << " MB/s";
+    numcfc::Logger::LogAndEcho(oss.str(), "recording-benchmark");
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const std::string filename = argc > 1 ? argv[1] : "recording-benchmark.nmr";
+    const size_t messageCount = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000;
+    const size_t messageSize = argc > 3 ? strtoul(argv[3], NULL, 10) : 200;
+
+    std::vector<slaim::Message> msgs(1000);
+    for (size_t i = 0; i < msgs.size(); ++i) {
+        msgs[i].m_type = "benchmark-" + std::to_string(i % 10);
+        msgs[i].m_text.resize(messageSize);
+        for (size_t j = 0; j < messageSize; ++j) {
+            msgs[i].m_text[j] = static_cast<char>('a' + (i + j) % 26);
+        }
+    }
+
+    const double totalBytes = static_cast<double>(messageCount) * (messageSize + msgs[0].m_type.length());
+
+    {
+        std::ofstream output(filename + ".legacy", std::ios::binary);
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < messageCount; ++i) {
+            claim::WriteMessageToStream(output, msgs[i % msgs.size()]);
+        }
+        output.flush();
+        Report("Legacy write", messageCount, totalBytes, SecondsSince(start));
+    }
+
+    {
+        std::ofstream output(filename, std::ios::binary);
+        const auto start = std::chrono::steady_clock::now();
+        {
+            claim::MessageRecordingWriter writer(output);
+            for (size_t i = 0; i < messageCount; ++i) {
+                writer.Write(msgs[i % msgs.size()]);
+            }
+        }
+        output.flush();
+        Report("Block write ", messageCount, totalBytes, SecondsSince(start));
+    }
+
+    {
+        const auto start = std::chrono::steady_clock::now();
+        claim::AsyncRecordingWriter writer(filename + ".async");
+        double maxWriteSeconds = 0;
+        for (size_t i = 0; i < messageCount; ++i) {
+            const auto writeStart = std::chrono::steady_clock::now();
+            writer.Write(msgs[i % msgs.size()]);
+            maxWriteSeconds = (std::max)(maxWriteSeconds, SecondsSince(writeStart));
+        }
+        const double appendSeconds = SecondsSince(start);
+        writer.Close();
+        const claim::AsyncRecordingWriter::Metrics metrics = writer.GetMetrics();
+        Report("Async append", messageCount, totalBytes, appendSeconds);
+        Report("Async write ", static_cast<size_t>(metrics.messageCount), totalBytes, SecondsSince(start));
+
+        std::ostringstream oss;
+        oss << "Async: dropped " << metrics.droppedMessageCount << " messages, max queue " << metrics.maxQueuedBlockCount
+            << " blocks, max Write() " << maxWriteSeconds * 1000 << " ms, max block write " << metrics.maxWriteSeconds * 1000 << " ms";
+        numcfc::Logger::LogAndEcho(oss.str(), "recording-benchmark");
+    }
+
+    {
+        std::ifstream input(filename + ".legacy", std::ios::binary);
+        const auto start = std::chrono::steady_clock::now();
+        slaim::Message msg;
+        size_t count = 0;
+        while (claim::ReadMessageFromStream(input, msg)) {
+            ++count;
+        }
+        Report("Legacy read ", count, totalBytes, SecondsSince(start));
+    }
+
+    {
+        std::ifstream input(filename + ".legacy", std::ios::binary);
+        const auto start = std::chrono::steady_clock::now();
+        claim::MessageStreamReader reader(input);
+        slaim::Message msg;
+        size_t count = 0;
+        while (reader.Read(msg) == claim::MessageStreamReader::Ok) {
+            ++count;
+        }
+        Report("Stream read ", count, totalBytes, SecondsSince(start));
+    }
+
+    {
+        std::ifstream input(filename, std::ios::binary);
+        const auto start = std::chrono::steady_clock::now();
+        claim::MessageRecordingReader reader(input);
+        slaim::Message msg;
+        size_t count = 0;
+        while (reader.Read(msg)) {
+            ++count;
+        }
+        Report("Block read  ", count, totalBytes, SecondsSince(start));
+    }
+
+    {
+        const auto start = std::chrono::steady_clock::now();
+        claim::MappedRecordingReader reader(filename);
+        claim::RecordedMessageView view;
+        size_t count = 0;
+        while (reader.Next(view)) {
+            ++count;
+        }
+        Report("Mapped read ", count, totalBytes, SecondsSince(start));
+    }
+
+    remove((filename + ".legacy").c_str());
+    remove((filename + ".async").c_str());
+    remove(filename.c_str());
+}
@@ -0,0 +1,173 @@
+//               Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// Republishes a recording, e.g. in order to load-test consumers with real traffic.
+//
+// Usage: recording-replay <recording> [options]
+//
+//   --speed N        replay N times faster than recorded (default: 1 = original timing)
+//   --max            replay as fast as possible
+//   --type T         replay only messages of type T (may be given several times)
+//   --from HH:MM:SS  start from this (local) time of the day the recording begins;
+//                    nanoseconds since 1970-01-01 UTC are accepted as well
+//   --to HH:MM:SS    stop at this time
+//   --batch N        send at most N messages at once (default: 1000)
+//
+// The messaging server is configured in recording-replay.ini.
+
+#include <messaging/claim/PostOffice.h>
+#include <messaging/claim/RecordingReplay.h>
+#include <numcfc/Logger.h>
+#include <numcfc/IniFile.h>
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <sstream>
+
+namespace {
+
+claim::RecordingReplayer* replayer = NULL;
+
+void OnSignal(int)
+{
+    if (replayer) {
+        replayer->Stop();
+    }
+}
+
+// Accepts either nanoseconds since the epoch, or HH:MM[:SS] on the (local) day of dayTimestamp.
+bool ParseTime(const char* text, uint64_t dayTimestamp, uint64_t& timestamp)
+{
+    int hours = 0, minutes = 0, seconds = 0;
+    if (strchr(text, ':') == NULL) {
+        char* end = NULL;
+        timestamp = strtoull(text, &end, 10);
+        return end != text && *end == '\0';
+    }
+    if (sscanf(text, "%d:%d:%d", &hours, &minutes, &seconds) < 2) {
+        return false;
+    }
+    time_t t = static_cast<time_t>(dayTimestamp / 1000000000);
+    struct tm day = *localtime(&t);
+    day.tm_hour = hours;
+    day.tm_min = minutes;
+    day.tm_sec = seconds;
+    day.tm_isdst = -1;
+    timestamp = static_cast<uint64_t>(mktime(&day)) * 1000000000;
+    return true;
+}
+
+void Report(const claim::RecordingReplayer::Statistics& statistics, const char* what)
+{
+    std::ostringstream oss;
+    oss << what << ": " << statistics.messageCount << " messages (" << statistics.byteCount / (1024.0 * 1024.0) << " MB) in "
+        << statistics.seconds << " s = " << statistics.GetMessagesPerSecond() << " msgs/s";
+    if (statistics.filteredCount > 0) {
+        oss << "; filtered out " << statistics.filteredCount;
+    }
+    if (statistics.sendBufferFullCount > 0) {
+        oss << "; send buffer full " << statistics.sendBufferFullCount << " times";
+    }
+    if (statistics.maxLagSeconds > 0) {
+        oss << "; max lag " << statistics.maxLagSeconds * 1000 << " ms";
+    }
+    numcfc::Logger::LogAndEcho(oss.str(), "recording-replay");
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <recording> [--speed N] [--max] [--type T]... [--from HH:MM:SS] [--to HH:MM:SS] [--batch N]\n", argv[0]);
+        return 1;
+    }
+
+    try {
+        claim::MappedRecordingReader reader(argv[1]);
+        if (reader.IsLegacyFormat()) {
+            numcfc::Logger::LogAndEcho("Legacy recording without timestamps - replaying as fast as possible", "recording-replay");
+        }
+
+        const std::vector<claim::RecordingIndex::Entry>& entries = reader.GetIndex().GetEntries();
+        const uint64_t firstTimestamp = entries.empty() ? reader.GetFileHeader().creationTimestamp : entries.front().firstTimestamp;
+
+        claim::RecordingReplayer recordingReplayer;
+        std::set<std::string, std::less<>> types;
+        uint64_t from = 0, to = (std::numeric_limits<uint64_t>::max)();
+
+        for (int i = 2; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--max") {
+                recordingReplayer.SetSpeed(0);
+            }
+            else if (arg == "--speed" && hasValue) {
+                recordingReplayer.SetSpeed(atof(argv[++i]));
+            }
+            else if (arg == "--type" && hasValue) {
+                types.insert(argv[++i]);
+            }
+            else if ((arg == "--from" || arg == "--to") && hasValue) {
+                if (!ParseTime(argv[++i], firstTimestamp, arg == "--from" ? from : to)) {
+                    fprintf(stderr, "Invalid time: %s\n", argv[i]);
+                    return 1;
+                }
+            }
+            else if (arg == "--batch" && hasValue) {
+                recordingReplayer.SetBatchSize(strtoul(argv[++i], NULL, 10));
+            }
+            else {
+                fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+                return 1;
+            }
+        }
+
+        recordingReplayer.SetTypeFilter(types);
+        recordingReplayer.SetTimeRange(from, to);
+        recordingReplayer.SetProgressCallback([](const claim::RecordingReplayer::Statistics& statistics) {
+            Report(statistics, "Progress");
+        });
+
+        numcfc::IniFile iniFile("recording-replay.ini");
+        claim::PostOffice postOffice;
+        postOffice.Initialize(iniFile, "replay");
+
+        if (iniFile.IsDirty()) {
+            numcfc::Logger::LogAndEcho("Saving the ini file...", "recording-replay");
+            iniFile.Save();
+        }
+
+        replayer = &recordingReplayer;
+        signal(SIGINT, OnSignal);
+        signal(SIGTERM, OnSignal);
+
+        const claim::RecordingReplayer::Statistics statistics = recordingReplayer.Replay(reader, postOffice);
+        replayer = NULL;
+
+        Report(statistics, "Replayed");
+
+        const double maxSecondsToFlush = 60.0;
+        if (!postOffice.Flush(maxSecondsToFlush)) {
+            numcfc::Logger::LogAndEcho("Not all the replayed messages were sent before exiting", "error");
+        }
+
+        const std::string error = postOffice.GetError();
+        if (!error.empty()) {
+            numcfc::Logger::LogAndEcho(error, "error");
+        }
+    }
+    catch (std::exception& e) {
+        numcfc::Logger::LogAndEcho(e.what(), "error");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,291 @@
+//               Copyright 2026 Juha Reunanen
+//
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// Searches recordings for matching messages, using all the cores.
+//
+// Usage: recording-scan <recording or segment directory>... [options]
+//
+//   --type T              only messages of type T (may be given several times)
+//   --attribute NAME=VAL  only messages whose attribute NAME is VAL (may be given several times)
+//   --from TIME           only messages recorded at or after TIME, given either as
+//                         YYYY-MM-DDTHH:MM:SS (local time) or as nanoseconds since 1970-01-01 UTC
+//   --to TIME             only messages recorded at or before TIME
+//   --prefix P            the prefix of the segment files in the directories (default: recording)
+//   --threads N           the number of worker threads (default: the number of cores)
+//   --output FILE         write the matching messages to a new recording
+//   --compress N          compress the new recording at zlib level N
+//   --csv FILE            write the matching messages as CSV (- = standard output)
+//   --column NAME         in the CSV, output attribute NAME instead of the whole text
+//                         (may be given several times; m_body is the body)
+//
+// Without --output or --csv, the matching messages are only counted.
+
+#include <messaging/claim/RecordingScan.h>
+#include <messaging/claim/SegmentedRecording.h>
+#include <messaging/claim/AttributeMessage.h>
+#include <numcfc/Logger.h>
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+
+namespace {
+
+claim::RecordingScanner* scanner = NULL;
+
+void OnSignal(int)
+{
+    if (scanner) {
+        scanner->Stop();
+    }
+}
+
+// Accepts either nanoseconds since the epoch, or YYYY-MM-DDTHH:MM[:SS] in local time.
+bool ParseTime(const char* text, uint64_t& timestamp)
+{
+    if (strchr(text, '-') == NULL) {
+        char* end = NULL;
+        timestamp = strtoull(text, &end, 10);
+        return end != text && *end == '\0';
+    }
+    struct tm t = {};
+    if (sscanf(text, "%d-%d-%dT%d:%d:%d", &t.tm_year, &t.tm_mon, &t.tm_mday, &t.tm_hour, &t.tm_min, &t.tm_sec) < 5) {
+        return false;
+    }
+    t.tm_year -= 1900;
+    t.tm_mon -= 1;
+    t.tm_isdst = -1;
+    timestamp = static_cast<uint64_t>(mktime(&t)) * 1000000000;
+    return true;
+}
+
+std::string FormatTime(uint64_t timestamp)
+{
+    const time_t seconds = static_cast<time_t>(timestamp / 1000000000);
+    char buffer[64];
+    const size_t length = strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", gmtime(&seconds));
+    snprintf(buffer + length, sizeof(buffer) - length, ".%09uZ", static_cast<unsigned>(timestamp % 1000000000));
+    return buffer;
+}
+
+void WriteCsvField(std::ostream& output, std::string_view field)
+{
+    if (field.find_first_of(",\"\r\n") == std::string_view::npos) {
+        output << field;
+        return;
+    }
+    output << '"';
+    for (char c : field) {
+        if (c == '"') {
+            output << '"';
+        }
+        output << c;
+    }
+    output << '"';
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <recording or segment directory>... [--type T]... [--attribute NAME=VALUE]... [--from TIME] [--to TIME]\n"
+                        "       [--prefix P] [--threads N] [--output FILE [--compress N]] [--csv FILE [--column NAME]...]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<std::string> inputs;
+    std::set<std::string, std::less<>> types;
+    std::vector<std::pair<std::string, std::string>> attributes;
+    std::vector<std::string> columns;
+    uint64_t from = 0, to = (std::numeric_limits<uint64_t>::max)();
+    std::string prefix = "recording";
+    std::string outputFilename, csvFilename;
+    unsigned int threadCount = 0;
+    int compressionLevel = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg.compare(0, 2, "--") != 0) {
+            inputs.push_back(arg);
+        }
+        else if (arg == "--type" && hasValue) {
+            types.insert(argv[++i]);
+        }
+        else if (arg == "--attribute" && hasValue) {
+            const std::string attribute = argv[++i];
+            const size_t equals = attribute.find('=');
+            if (equals == std::string::npos) {
+                fprintf(stderr, "Invalid attribute filter: %s\n", attribute.c_str());
+                return 1;
+            }
+            attributes.push_back(std::make_pair(attribute.substr(0, equals), attribute.substr(equals + 1)));
+        }
+        else if ((arg == "--from" || arg == "--to") && hasValue) {
+            if (!ParseTime(argv[++i], arg == "--from" ? from : to)) {
+                fprintf(stderr, "Invalid time: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (arg == "--prefix" && hasValue) {
+            prefix = argv[++i];
+        }
+        else if (arg == "--threads" && hasValue) {
+            threadCount = static_cast<unsigned int>(strtoul(argv[++i], NULL, 10));
+        }
+        else if (arg == "--output" && hasValue) {
+            outputFilename = argv[++i];
+        }
+        else if (arg == "--compress" && hasValue) {
+            compressionLevel = atoi(argv[++i]);
+        }
+        else if (arg == "--csv" && hasValue) {
+            csvFilename = argv[++i];
+        }
+        else if (arg == "--column" && hasValue) {
+            columns.push_back(argv[++i]);
+        }
+        else {
+            fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    // with the CSV on the standard output, keep the log messages out of it
+    const bool echo = csvFilename != "-";
+    auto log = [echo](const std::string& text, const char* logName) {
+        if (echo) {
+            numcfc::Logger::LogAndEcho(text, logName);
+        }
+        else {
+            numcfc::Logger::LogNoEcho(text, logName);
+        }
+    };
+
+    try {
+        std::vector<std::string> filenames;
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            if (std::filesystem::is_directory(inputs[i])) {
+                const std::vector<claim::RecordingSegment> segments = claim::ListRecordingSegments(inputs[i], prefix);
+                for (size_t j = 0; j < segments.size(); ++j) {
+                    filenames.push_back(segments[j].filename);
+                }
+            }
+            else {
+                filenames.push_back(inputs[i]);
+            }
+        }
+
+        claim::RecordingScanner recordingScanner(threadCount);
+        recordingScanner.SetTypeFilter(types);
+        recordingScanner.SetTimeRange(from, to);
+        for (size_t i = 0; i < attributes.size(); ++i) {
+            recordingScanner.AddAttributeFilter(attributes[i].first, attributes[i].second);
+        }
+
+        std::ofstream recordingFile;
+        std::unique_ptr<claim::MessageRecordingWriter> writer;
+        if (!outputFilename.empty()) {
+            recordingFile.open(outputFilename.c_str(), std::ios::binary);
+            if (!recordingFile) {
+                throw std::runtime_error("Unable to create " + outputFilename);
+            }
+            writer.reset(new claim::MessageRecordingWriter(recordingFile));
+            writer->SetCompressionLevel(compressionLevel);
+        }
+
+        std::ofstream csvFile;
+        std::ostream* csv = NULL;
+        if (csvFilename == "-") {
+            csv = &std::cout;
+        }
+        else if (!csvFilename.empty()) {
+            csvFile.open(csvFilename.c_str());
+            if (!csvFile) {
+                throw std::runtime_error("Unable to create " + csvFilename);
+            }
+            csv = &csvFile;
+        }
+        if (csv) {
+            *csv << "timestamp,type";
+            if (columns.empty()) {
+                *csv << ",text";
+            }
+            for (size_t i = 0; i < columns.size(); ++i) {
+                *csv << ',';
+                WriteCsvField(*csv, columns[i]);
+            }
+            *csv << '\n';
+        }
+
+        scanner = &recordingScanner;
+        signal(SIGINT, OnSignal);
+        signal(SIGTERM, OnSignal);
+
+        slaim::Message msg;
+        const claim::RecordingScanner::Statistics statistics = recordingScanner.Scan(filenames, [&](const claim::RecordedMessageView& view) {
+            if (writer) {
+                view.ToMessage(msg);
+                writer->Write(msg, view.timestamp);
+            }
+            if (csv) {
+                *csv << FormatTime(view.timestamp) << ',';
+                WriteCsvField(*csv, view.type);
+                if (columns.empty()) {
+                    *csv << ',';
+                    WriteCsvField(*csv, view.text);
+                }
+                for (size_t i = 0; i < columns.size(); ++i) {
+                    std::string_view value;
+                    *csv << ',';
+                    if (claim::FindAttribute(view.text, columns[i], value)) {
+                        WriteCsvField(*csv, value);
+                    }
+                }
+                *csv << '\n';
+            }
+        });
+        scanner = NULL;
+
+        if (writer) {
+            writer->Close();
+        }
+        if (csv) {
+            csv->flush();
+        }
+
+        std::ostringstream oss;
+        oss << "Scanned " << statistics.messageCount << " messages (" << statistics.byteCount / (1024.0 * 1024.0) << " MB) in "
+            << statistics.fileCount << " files using " << recordingScanner.GetThreadCount() << " threads in " << statistics.seconds << " s = "
+            << statistics.GetMessagesPerSecond() << " msgs/s, " << statistics.GetBytesPerSecond() / (1024.0 * 1024.0) << " MB/s; "
+            << statistics.matchCount << " matches";
+        if (statistics.skippedBlockCount > 0) {
+            oss << "; skipped " << statistics.skippedBlockCount << " of " << statistics.skippedBlockCount + statistics.blockCount << " blocks using the index";
+        }
+        log(oss.str(), "recording-scan");
+
+        if (statistics.corruptBlockCount > 0) {
+            std::ostringstream error;
+            error << statistics.corruptBlockCount << " corrupt blocks";
+            log(error.str(), "error");
+        }
+    }
+    catch (std::exception& e) {
+        log(e.what(), "error");
+        return 1;
+    }
+
+    return 0;
+}